@@ -5,307 +5,1668 @@ using namespace std;
 
 namespace H3FontExtension
 {
+    int __fastcall GetGlyphCodePoint(int nIndex)
+    {
+        static vector<int> codePoints;
+        if (codePoints.empty())
+        {
+            codePoints.resize(CurrentEncoding.GetGlyphCount(), -1);
+            for (int i = 0; i < CurrentEncoding.GetGlyphCount(); ++i)
+            {
+                char code[2] = {(char)CurrentEncoding.GetLeadByte(i), (char)CurrentEncoding.GetTrailByte(i)};
+                wchar_t unicode[2];
+                if (MultiByteToWideChar(CurrentEncoding.CodePage, MB_ERR_INVALID_CHARS, code, 2, unicode, 2) == 1)
+                {
+                    codePoints[i] = unicode[0];
+                }
+            }
+        }
+        return (unsigned)nIndex < codePoints.size() ? codePoints[nIndex] : -1;
+    }
+
+    int __fastcall GetCodePointGlyph(int nCodePoint)
+    {
+        // 两级转换表：高8位 -> 页号 + 1，页内低8位 -> GBK字符序号 + 1，只存储有字符的页
+        static vector<uint16_t> pageTable;
+        static vector<array<uint16_t, 256>> pages;
+        if (pageTable.empty())
+        {
+            pageTable.resize(256);
+            for (int i = 0; i < GbkEncoding::Info.GetGlyphCount(); ++i)
+            {
+                char code[2] = {(char)GbkEncoding::Info.GetLeadByte(i), (char)GbkEncoding::Info.GetTrailByte(i)};
+                wchar_t unicode[2];
+                if (MultiByteToWideChar(GbkEncoding::Info.CodePage, MB_ERR_INVALID_CHARS, code, 2, unicode, 2) != 1)
+                {
+                    continue;
+                }
+
+                uint16_t& nPage = pageTable[unicode[0] >> 8];
+                if (!nPage)
+                {
+                    pages.emplace_back();
+                    nPage = (uint16_t)pages.size();
+                }
+                uint16_t& nSlot = pages[nPage - 1][unicode[0] & 0xFF];
+                if (!nSlot)
+                {
+                    nSlot = (uint16_t)(i + 1);
+                }
+            }
+        }
+
+        if ((unsigned)nCodePoint >= 0x10000 || !pageTable[nCodePoint >> 8])
+        {
+            return -1;
+        }
+        return pages[pageTable[nCodePoint >> 8] - 1][nCodePoint & 0xFF] - 1;
+    }
+
+    int __fastcall GetEllipsisGlyph()
+    {
+        static int nEllipsis = -2;
+        if (nEllipsis == -2)
+        {
+            nEllipsis = -1;
+            for (int i = 0; i < CurrentEncoding.GetGlyphCount(); ++i)
+            {
+                if ((CurrentEncoding.Unicode ? i : GetGlyphCodePoint(i)) == 0x2026)
+                {
+                    nEllipsis = i;
+                    break;
+                }
+            }
+        }
+        return nEllipsis;
+    }
+
+    void __fastcall GlyphSource::Wait(int nWidth, int nHeight)
+    {
+        if (this->Loaded || !this->FileFuture.valid())
+        {
+            return;
+        }
+        this->Loaded = true;
+        this->File = this->FileFuture.get();
+        if (!this->Bank.Parse(this->File.Buffer, this->File.Size))
+        {
+            return;
+        }
+
+        // 距离场字库按配置尺寸采样，不要求尺寸一致
+        if (!this->Bank.IsDistanceField() &&
+            (this->Bank.Header->Width != nWidth || this->Bank.Header->Height != nHeight))
+        {
+            MessageBoxW(h3::H3Hwnd::Get(), L"字库尺寸与配置不一致", L"错误", 0);
+            this->Bank = GlyphBankView();
+            this->File = FontFile();
+            return;
+        }
+        this->BitDepth = this->Bank.Header->BitDepth;
+    }
+
+    void __fastcall GlyphSource::BuildPresenceAsync(int nWidth, int nHeight)
+    {
+        // 字符序号转换表首次使用时生成，先在主线程中生成，工作线程只读取
+        if (CurrentEncoding.Unicode)
+        {
+            GetCodePointGlyph(0);
+        }
+        else
+        {
+            GetGlyphCodePoint(0);
+        }
+
+        auto promise = make_shared<std::promise<vector<uint64_t>>>();
+        this->PresenceFuture = promise->get_future().share();
+
+        // 工作线程在字库副本上查找字符，不访问主线程中的字库状态
+        GetWorkerPool().Submit([fileFuture = this->FileFuture, nBitDepth = this->BitDepth, nWidth, nHeight, promise] {
+            GlyphSource source;
+            source.File = fileFuture.get();
+            source.BitDepth = nBitDepth;
+            int nGlyphCount = CurrentEncoding.GetGlyphCount();
+            vector<uint64_t> presence((nGlyphCount + 63) >> 6);
+            if (source.Bank.Parse(source.File.Buffer, source.File.Size) && !source.Bank.IsDistanceField() &&
+                (source.Bank.Header->Width != nWidth || source.Bank.Header->Height != nHeight))
+            {
+                // 尺寸不一致时主线程等待字库时报错并弃用字库，视为不存在任何字符
+                promise->set_value(std::move(presence));
+                return;
+            }
+
+            size_t nGlyphSize = GetPackedGlyphSize(nWidth, nHeight, source.BitDepth);
+            for (int i = 0; i < nGlyphCount; ++i)
+            {
+                const uint8_t* pGlyph = source.Find(i, nWidth, nHeight);
+                if (pGlyph && (source.Bank.Header || any_of(pGlyph, pGlyph + nGlyphSize, [](uint8_t c) { return c; })))
+                {
+                    presence[i >> 6] |= 1ull << (i & 63);
+                }
+            }
+            promise->set_value(std::move(presence));
+        });
+    }
+
+    void __fastcall GlyphSource::WaitPresence(int nWidth, int nHeight)
+    {
+        if (!this->Presence.empty())
+        {
+            return;
+        }
+        Wait(nWidth, nHeight);
+        this->Presence = this->PresenceFuture.get();
+    }
+
+    const GlyphSource* __fastcall ExtFont::ResolveSource(int nIndex)
+    {
+        if (this->ResolvedSources.empty())
+        {
+            this->ResolvedSources.resize(CurrentEncoding.GetGlyphCount());
+        }
+
+        uint8_t& nResolved = this->ResolvedSources[nIndex];
+        if (!nResolved)
+        {
+            nResolved = ResolvedMissing;
+            this->Source.WaitPresence(this->SourceWidth, this->SourceHeight);
+            if (this->Source.Contains(nIndex))
+            {
+                nResolved = 1;
+            }
+            for (size_t i = 0; nResolved == ResolvedMissing && i < this->Fallbacks.size(); ++i)
+            {
+                GlyphSource& fallback = this->Fallbacks[i];
+                if (!fallback.FileFuture.valid())
+                {
+                    fallback.FileFuture = LoadFontBankAsync(this->FallbackFileNames[i]);
+                    fallback.BuildPresenceAsync(this->SourceWidth, this->SourceHeight);
+                }
+                fallback.WaitPresence(this->SourceWidth, this->SourceHeight);
+                if (fallback.Contains(nIndex))
+                {
+                    nResolved = (uint8_t)(i + 2);
+                }
+            }
+        }
+
+        if (nResolved == ResolvedMissing)
+        {
+            return nullptr;
+        }
+        return nResolved == 1 ? &this->Source : &this->Fallbacks[nResolved - 2];
+    }
+
+    const GlyphBitmap* __fastcall ExtFont::MakeGlyphBitmap(const uint8_t* pCoverage)
+    {
+        // 阴影向右下偏移1像素，字符画随之扩大1像素
+        int nShadow = this->DrawShadow ? 1 : 0;
+        int nWidth = this->Width + nShadow;
+        int nHeight = this->Height + nShadow;
+        size_t nSize = nWidth * nHeight;
+        PUINT8 pBuffer = this->GlyphCacheArena.Allocate(nSize * (nShadow + 1));
+        memset(pBuffer, 0, nSize * (nShadow + 1));
+        PUINT8 pShadow = nShadow ? pBuffer + nSize : nullptr;
+        for (int nRow = 0; nRow < this->Height; ++nRow)
+        {
+            for (int nColumn = 0; nColumn < this->Width; ++nColumn)
+            {
+                uint8_t alpha = pCoverage[nRow * this->Width + nColumn];
+                pBuffer[nRow * nWidth + nColumn] = alpha;
+                if (alpha && pShadow)
+                {
+                    pShadow[(nRow + 1) * nWidth + nColumn + 1] = 255;
+                }
+            }
+        }
+        // 阴影掩码不含文字像素，每个像素只写入一次
+        for (size_t i = 0; pShadow && i < nSize; ++i)
+        {
+            pShadow[i] = pBuffer[i] ? 0 : pShadow[i];
+        }
+
+        return &this->GlyphBitmaps.emplace_back(GlyphBitmap{pBuffer, pShadow, nWidth, nHeight, this->MarginLeft});
+    }
+
+    const GlyphBitmap* __fastcall ExtFont::MakeDistanceFieldGlyph(const GlyphBankHeader* pHeader, const uint8_t* pField)
+    {
+        if (this->FieldHeader != pHeader)
+        {
+            this->FieldHeader = pHeader;
+            this->FieldSampler = DistanceFieldSampler(pHeader->Width, pHeader->Height, pHeader->FieldPadding,
+                                                      pHeader->FieldSpread, this->Width, this->Height);
+            this->FieldRamp = this->FieldSampler.MakeRamp(0, 1);
+            this->ShadowRamp = this->FieldSampler.MakeRamp(0.5f, 2);
+        }
+
+        // 柔和阴影向右下偏移1像素，边缘向外过渡1.5像素，字符画随之扩大2像素
+        int nMargin = this->DrawShadow ? 2 : 0;
+        int nWidth = this->Width + nMargin;
+        int nHeight = this->Height + nMargin;
+        size_t nSize = nWidth * nHeight;
+        PUINT8 pBuffer = this->GlyphCacheArena.Allocate(nSize * (nMargin ? 2 : 1));
+        PUINT8 pShadow = nMargin ? pBuffer + nSize : nullptr;
+        this->FieldSampler.Sample(pField, this->FieldRamp, pBuffer, nWidth, nHeight);
+        if (pShadow)
+        {
+            this->FieldSampler.Sample(pField, this->ShadowRamp, pShadow, nWidth, nHeight, -1, -1);
+            // 文字完全覆盖处不绘制阴影
+            for (size_t i = 0; i < nSize; ++i)
+            {
+                pShadow[i] = pBuffer[i] == 255 ? 0 : pShadow[i];
+            }
+        }
+
+        return &this->GlyphBitmaps.emplace_back(GlyphBitmap{pBuffer, pShadow, nWidth, nHeight, this->MarginLeft});
+    }
+
+    const GlyphBitmap* __fastcall ExtFont::GetReplacementGlyph()
+    {
+        if (!this->ReplacementGlyph)
+        {
+            // 空心方框，四周留1像素边距
+            vector<uint8_t> coverage(this->Width * this->Height);
+            for (int nRow = 1; nRow < this->Height - 1; ++nRow)
+            {
+                for (int nColumn = 1; nColumn < this->Width - 1; ++nColumn)
+                {
+                    if (nRow == 1 || nRow == this->Height - 2 || nColumn == 1 || nColumn == this->Width - 2)
+                    {
+                        coverage[nRow * this->Width + nColumn] = 255;
+                    }
+                }
+            }
+            this->ReplacementGlyph = MakeGlyphBitmap(coverage.data());
+        }
+        return this->ReplacementGlyph;
+    }
+
+    const GlyphBitmap* __fastcall ExtFont::GetGlyph(int nIndex)
+    {
+        if (nIndex < 0)
+        {
+            return GetReplacementGlyph();
+        }
+        if ((unsigned)nIndex >= (unsigned)CurrentEncoding.GetGlyphCount())
+        {
+            return &this->BlankGlyph;
+        }
+
+        if (this->GlyphCache.empty())
+        {
+            this->GlyphCache.resize(CurrentEncoding.GetGlyphCount());
+        }
+        const GlyphBitmap*& pGlyph = this->GlyphCache[nIndex];
+        if (pGlyph)
+        {
+            return pGlyph;
+        }
+
+        const GlyphSource* pSource = &this->Source;
+        if (!this->Fallbacks.empty())
+        {
+            pSource = ResolveSource(nIndex);
+        }
+        const uint8_t* pPacked = pSource ? pSource->Find(nIndex, this->SourceWidth, this->SourceHeight) : nullptr;
+        if (!pPacked)
+        {
+            pGlyph = &this->BlankGlyph;
+            return pGlyph;
+        }
+        if (pSource->Bank.Header && pSource->Bank.IsDistanceField())
+        {
+            pGlyph = MakeDistanceFieldGlyph(pSource->Bank.Header, pPacked);
+            return pGlyph;
+        }
+
+        size_t nGlyphSize = this->Width * this->Height;
+        if (this->IsScaled() && pSource == &this->Source && this->ScaledGlyphs.valid() &&
+            this->ScaledGlyphs.wait_for(chrono::seconds(0)) == future_status::ready)
+        {
+            // 预先缩放的字符按字库存储顺序排列
+            const uint8_t* pData = pSource->Bank.Header ? pSource->Bank.Data : pSource->File.Buffer;
+            size_t nPackedSize = GetPackedGlyphSize(this->SourceWidth, this->SourceHeight, pSource->BitDepth);
+            size_t nSlot = (pPacked - pData) / nPackedSize;
+            const vector<uint8_t>& scaled = this->ScaledGlyphs.get();
+            if ((nSlot + 1) * nGlyphSize <= scaled.size())
+            {
+                pGlyph = MakeGlyphBitmap(scaled.data() + nSlot * nGlyphSize);
+                return pGlyph;
+            }
+        }
+
+        const uint8_t* pCoverage = pPacked;
+        if (pSource->BitDepth != 8)
+        {
+            static vector<uint8_t> coverage;
+            coverage.resize(this->SourceWidth * this->SourceHeight);
+            ExpandGlyph(pPacked, coverage.data(), this->SourceWidth, this->SourceHeight, pSource->BitDepth);
+            pCoverage = coverage.data();
+        }
+        if (this->IsScaled())
+        {
+            static vector<uint8_t> scaled;
+            scaled.resize(nGlyphSize);
+            this->Scaler.Scale(pCoverage, scaled.data());
+            pCoverage = scaled.data();
+        }
+        pGlyph = MakeGlyphBitmap(pCoverage);
+        return pGlyph;
+    }
+
+    const GlyphBitmap* __fastcall ExtFont::GetStyledGlyph(int nIndex, int nStyle)
+    {
+        const GlyphBitmap* pGlyph = GetGlyph(nIndex);
+        const GlyphStyle* pStyle = GetStyle(nStyle);
+        // 全部为0的样式与无样式相同，不复制缓存字符
+        if (!pStyle || pStyle->IsPlain() || pGlyph == &this->BlankGlyph)
+        {
+            return pGlyph;
+        }
+
+        // 每种样式单独缓存，绘制时与无样式字符开销相同
+        this->StyledGlyphCaches.resize(this->Styles.size());
+        vector<const GlyphBitmap*>& cache = this->StyledGlyphCaches[nStyle - 1];
+        if (cache.empty())
+        {
+            cache.resize(CurrentEncoding.GetGlyphCount() + 1);
+        }
+        const GlyphBitmap*& pStyled = cache[nIndex < 0 ? cache.size() - 1 : nIndex];
+        if (!pStyled)
+        {
+            pStyled = &this->GlyphBitmaps.emplace_back(ApplyGlyphStyle(*pGlyph, *pStyle, this->GlyphCacheArena));
+        }
+        return pStyled;
+    }
+
+    const GlyphBitmap* __fastcall ExtFont::GetIconGlyph(int nIcon)
+    {
+        if (this->IconGlyphs.empty())
+        {
+            this->IconGlyphs.resize(InlineIcons.size());
+        }
+        const GlyphBitmap*& pGlyph = this->IconGlyphs[nIcon];
+        if (pGlyph)
+        {
+            return pGlyph;
+        }
+
+        LoadIconAtlas();
+        auto [nLeft, nSourceWidth, nSourceHeight] = InlineIconAtlas.Rects[nIcon];
+        if (!nSourceWidth)
+        {
+            pGlyph = &this->BlankGlyph;
+            return pGlyph;
+        }
+
+        // 按高度等比缩放，颜色已预乘不透明度，边缘不会混入透明像素的颜色
+        int nHeight = InlineIcons[nIcon].Height > 0 ? InlineIcons[nIcon].Height : this->Height;
+        int nWidth = max(1, (nSourceWidth * nHeight + nSourceHeight / 2) / nSourceHeight);
+        GlyphScaler scaler(nSourceWidth, nSourceHeight, nWidth, nHeight);
+        size_t nSize = nWidth * nHeight;
+        vector<uint8_t> source(nSourceWidth * nSourceHeight);
+        array<vector<uint8_t>, 4> planes;
+        for (int nPlane = 0; nPlane < 4; ++nPlane)
+        {
+            for (int nRow = 0; nRow < nSourceHeight; ++nRow)
+            {
+                copy_n(InlineIconAtlas.Planes[nPlane].data() + nRow * InlineIconAtlas.Width + nLeft, nSourceWidth,
+                       source.data() + nRow * nSourceWidth);
+            }
+            planes[nPlane].resize(nSize);
+            scaler.Scale(source.data(), planes[nPlane].data());
+        }
+
+        PUINT8 pBuffer = this->GlyphCacheArena.Allocate(nSize * (sizeof(uint32_t) + 1) + alignof(uint32_t) - 1);
+        uint32_t* pColors = (uint32_t*)(((uintptr_t)pBuffer + alignof(uint32_t) - 1) & ~(alignof(uint32_t) - 1));
+        PUINT8 pCoverage = (PUINT8)(pColors + nSize);
+        for (size_t i = 0; i < nSize; ++i)
+        {
+            uint32_t nAlpha = planes[3][i];
+            pCoverage[i] = (uint8_t)nAlpha;
+            pColors[i] = 0;
+            for (int nPlane = 0; nAlpha && nPlane < 3; ++nPlane)
+            {
+                pColors[i] = pColors[i] << 8 | min(planes[nPlane][i] * 255 / nAlpha, 255u);
+            }
+        }
+
+        pGlyph = &this->GlyphBitmaps.emplace_back(GlyphBitmap{pCoverage, nullptr, nWidth, nHeight, this->MarginLeft,
+                                                              nullptr, 0, (this->Height - nHeight) / 2, pColors});
+        return pGlyph;
+    }
+
+    void __fastcall ExtFont::PrescaleGlyphs()
+    {
+        auto promise = make_shared<std::promise<vector<uint8_t>>>();
+        this->ScaledGlyphs = promise->get_future().share();
+
+        // 工作线程只读取字库文件，不访问主线程中的字库状态
+        GetWorkerPool().Submit([fontFile = this->Source.FileFuture, scaler = this->Scaler,
+                                nBitDepth = this->Source.BitDepth, nSourceWidth = this->SourceWidth,
+                                nSourceHeight = this->SourceHeight, nGlyphSize = (size_t)this->Width * this->Height,
+                                promise]() mutable {
+            FontFile file = fontFile.get();
+            const uint8_t* pData = file.Buffer;
+            size_t nPackedSize = GetPackedGlyphSize(nSourceWidth, nSourceHeight, nBitDepth);
+            size_t nCount = file.Size / nPackedSize;
+            GlyphBankView bank;
+            if (bank.Parse(file.Buffer, file.Size))
+            {
+                // 尺寸不一致时主线程等待字库时报错，这里不生成
+                bool bMatched = bank.Header->Width == nSourceWidth && bank.Header->Height == nSourceHeight;
+                pData = bank.Data;
+                nBitDepth = bank.Header->BitDepth;
+                nPackedSize = bank.GlyphSize;
+                nCount = bMatched ? bank.Header->GlyphCount : 0;
+            }
+
+            vector<uint8_t> scaled(nCount * nGlyphSize);
+            vector<uint8_t> coverage(nSourceWidth * nSourceHeight);
+            for (size_t i = 0; i < nCount; ++i)
+            {
+                const uint8_t* pPacked = pData + i * nPackedSize;
+                if (nBitDepth != 8)
+                {
+                    ExpandGlyph(pPacked, coverage.data(), nSourceWidth, nSourceHeight, nBitDepth);
+                    pPacked = coverage.data();
+                }
+                scaler.Scale(pPacked, scaled.data() + i * nGlyphSize);
+            }
+            promise->set_value(std::move(scaled));
+        });
+    }
+
+    const GlyphBitmap* __fastcall GetAsciiGlyphs(H3Font* pFont, const GlyphStyle* pStyle)
+    {
+        if (pStyle && pStyle->IsPlain())
+        {
+            pStyle = nullptr;
+        }
+        AsciiGlyphSet& glyphSet = AsciiGlyphMap[{pFont, pStyle}];
+        if (glyphSet.pSource == pFont->bitmapBuffer)
+        {
+            return glyphSet.Glyphs.data();
+        }
+
+        // 字体重新加载后重新生成字符画，旧的字符画不再使用
+        glyphSet.pSource = pFont->bitmapBuffer;
+        glyphSet.Arena = GlyphArena();
+        if (pStyle)
+        {
+            const GlyphBitmap* pGlyphs = GetAsciiGlyphs(pFont);
+            for (int nChar = 0; nChar < 256; ++nChar)
+            {
+                glyphSet.Glyphs[nChar] = ApplyGlyphStyle(pGlyphs[nChar], *pStyle, glyphSet.Arena);
+            }
+            return glyphSet.Glyphs.data();
+        }
+
+        for (int nChar = 0; nChar < 256; ++nChar)
+        {
+            const H3Font::FontSpacing& spacing = pFont->width[nChar];
+            int nWidth = max(spacing.span, 0);
+            size_t nSize = nWidth * pFont->height;
+            PUINT8 pBuffer = glyphSet.Arena.Allocate(nSize * 2);
+            PUINT8 pShadow = pBuffer + nSize;
+            bool bShadow = false;
+            const UINT8* pFontBuffer = pFont->GetChar(nChar);
+            for (size_t i = 0; i < nSize; ++i)
+            {
+                // 255表示正常颜色，其他非0值表示阴影
+                pBuffer[i] = pFontBuffer[i] == 255 ? 255 : 0;
+                pShadow[i] = pFontBuffer[i] && pFontBuffer[i] != 255 ? 255 : 0;
+                bShadow |= pShadow[i] != 0;
+            }
+            glyphSet.Glyphs[nChar] =
+                GlyphBitmap{pBuffer, bShadow ? pShadow : nullptr, nWidth, pFont->height, spacing.leftMargin};
+        }
+        return glyphSet.Glyphs.data();
+    }
+
+    void __fastcall LoadIconAtlas()
+    {
+        if (InlineIconAtlas.Loaded)
+        {
+            return;
+        }
+        InlineIconAtlas.Loaded = true;
+
+        struct IconImage
+        {
+            int nWidth = 0;
+            int nHeight = 0;
+            array<vector<uint8_t>, 4> planes;
+        };
+
+        vector<IconImage> images(InlineIcons.size());
+        for (size_t i = 0; i < InlineIcons.size(); ++i)
+        {
+            const InlineIcon& icon = InlineIcons[i];
+            H3LoadedDef* pDef = nullptr;
+            H3LoadedPcx* pPcx = nullptr;
+            int nWidth = 0;
+            int nHeight = 0;
+            if (!icon.Def.empty())
+            {
+                pDef = H3LoadedDef::Load(icon.Def.c_str());
+                if (pDef && (icon.Group < 0 || icon.Group >= pDef->groupsCount || !pDef->groups[icon.Group] ||
+                             icon.Frame < 0 || icon.Frame >= pDef->groups[icon.Group]->count))
+                {
+                    pDef->Dereference();
+                    pDef = nullptr;
+                }
+                if (pDef)
+                {
+                    nWidth = pDef->widthDEF;
+                    nHeight = pDef->heightDEF;
+                }
+            }
+            else if (!icon.Pcx.empty())
+            {
+                pPcx = H3LoadedPcx::Load(icon.Pcx.c_str());
+                if (pPcx)
+                {
+                    nWidth = pPcx->width;
+                    nHeight = pPcx->height;
+                }
+            }
+            if (nWidth <= 0 || nHeight <= 0)
+            {
+                continue;
+            }
+
+            // 分别绘制到黑色与白色背景上，两次结果之差为透出的背景，由此还原不透明度与预乘颜色
+            H3LoadedPcx16* pCanvas = H3LoadedPcx16::Create(nWidth, nHeight);
+            array<vector<H3ARGB888>, 2> layers;
+            array<H3ARGB888, 2> backgrounds;
+            for (int nLayer = 0; nLayer < 2; ++nLayer)
+            {
+                BYTE nFill = nLayer ? 255 : 0;
+                pCanvas->FillRectangle(0, 0, nWidth, nHeight, nFill, nFill, nFill);
+                // 16位色模式下背景读回的颜色与填充值不完全相同
+                backgrounds[nLayer] = pCanvas->GetPixel(0, 0);
+                if (pDef)
+                {
+                    pDef->DrawToPcx16(icon.Group, icon.Frame, pCanvas, 0, 0);
+                }
+                else
+                {
+                    pPcx->DrawToPcx16(pCanvas, 0, 0, TRUE);
+                }
+
+                layers[nLayer].resize(nWidth * nHeight);
+                for (int nRow = 0; nRow < nHeight; ++nRow)
+                {
+                    for (int nColumn = 0; nColumn < nWidth; ++nColumn)
+                    {
+                        layers[nLayer][nRow * nWidth + nColumn] = pCanvas->GetPixel(nColumn, nRow);
+                    }
+                }
+            }
+            pCanvas->Dereference();
+            pDef ? pDef->Dereference() : pPcx->Dereference();
+
+            auto sum = [](const H3ARGB888& color) { return color.r + color.g + color.b; };
+            int nRange = max(sum(backgrounds[1]) - sum(backgrounds[0]), 1);
+            vector<uint8_t> alphas(nWidth * nHeight);
+            int nLeft = nWidth, nTop = nHeight, nRight = 0, nBottom = 0;
+            for (int nRow = 0; nRow < nHeight; ++nRow)
+            {
+                for (int nColumn = 0; nColumn < nWidth; ++nColumn)
+                {
+                    int nPixel = nRow * nWidth + nColumn;
+                    int nShown = sum(layers[1][nPixel]) - sum(layers[0][nPixel]);
+                    alphas[nPixel] = (uint8_t)(255 - clamp(nShown * 255 / nRange, 0, 255));
+                    if (alphas[nPixel])
+                    {
+                        nLeft = min(nLeft, nColumn);
+                        nTop = min(nTop, nRow);
+                        nRight = max(nRight, nColumn + 1);
+                        nBottom = max(nBottom, nRow + 1);
+                    }
+                }
+            }
+            if (nLeft >= nRight)
+            {
+                continue;
+            }
+
+            // 裁剪到不透明范围
+            IconImage& image = images[i];
+            image.nWidth = nRight - nLeft;
+            image.nHeight = nBottom - nTop;
+            for (vector<uint8_t>& plane : image.planes)
+            {
+                plane.resize(image.nWidth * image.nHeight);
+            }
+            for (int nRow = 0; nRow < image.nHeight; ++nRow)
+            {
+                for (int nColumn = 0; nColumn < image.nWidth; ++nColumn)
+                {
+                    int nPixel = (nTop + nRow) * nWidth + nLeft + nColumn;
+                    int nTarget = nRow * image.nWidth + nColumn;
+                    const H3ARGB888& color = layers[0][nPixel];
+                    const H3ARGB888& background = backgrounds[0];
+                    uint8_t nAlpha = alphas[nPixel];
+                    image.planes[0][nTarget] = (uint8_t)clamp(color.r - background.r, 0, (int)nAlpha);
+                    image.planes[1][nTarget] = (uint8_t)clamp(color.g - background.g, 0, (int)nAlpha);
+                    image.planes[2][nTarget] = (uint8_t)clamp(color.b - background.b, 0, (int)nAlpha);
+                    image.planes[3][nTarget] = nAlpha;
+                }
+            }
+        }
+
+        // 图标横向排列在同一图集中
+        IconAtlas& atlas = InlineIconAtlas;
+        for (const IconImage& image : images)
+        {
+            atlas.Rects.push_back({atlas.Width, image.nWidth, image.nHeight});
+            atlas.Width += image.nWidth;
+            atlas.Height = max(atlas.Height, image.nHeight);
+        }
+        for (int nPlane = 0; nPlane < 4; ++nPlane)
+        {
+            atlas.Planes[nPlane].assign(atlas.Width * atlas.Height, 0);
+            for (size_t i = 0; i < images.size(); ++i)
+            {
+                const IconImage& image = images[i];
+                for (int nRow = 0; nRow < image.nHeight; ++nRow)
+                {
+                    copy_n(image.planes[nPlane].data() + nRow * image.nWidth, image.nWidth,
+                           atlas.Planes[nPlane].data() + nRow * atlas.Width + atlas.Rects[i][0]);
+                }
+            }
+        }
+    }
+
+    int __fastcall ParseIconMarkup(string_view text, size_t nPos, size_t& nLength)
+    {
+        if (InlineIconNames.empty() || nPos + 2 >= text.length() || text[nPos + 1] != '@')
+        {
+            return -1;
+        }
+
+        size_t nEnd = text.find('}', nPos + 2);
+        if (nEnd == string_view::npos)
+        {
+            return -1;
+        }
+        auto it = InlineIconNames.find(text.substr(nPos + 2, nEnd - nPos - 2));
+        if (it == InlineIconNames.end())
+        {
+            return -1;
+        }
+        nLength = nEnd - nPos + 1;
+        return it->second;
+    }
+
+    const DWORD* __fastcall GetShadeTable(DWORD color)
+    {
+        auto [it, bInserted] = ShadeTables.try_emplace(color);
+        array<DWORD, 256>& shades = it->second;
+        if (bInserted)
+        {
+            shades[0] = color;
+            for (int alpha = 1; alpha < 255; ++alpha)
+            {
+                auto rgbFontColor = H3ARGB888(color);
+                rgbFontColor.Darken(-alpha);
+                shades[alpha] = rgbFontColor.Value();
+            }
+            shades[255] = color;
+        }
+        return shades.data();
+    }
+
+    /**
+     * @brief 获取英文字体和汉字库字体映射
+     * @param pFont 英文字体
+     * @return 汉字字库字体
+     */
+    ExtFont* __fastcall GetMappedExtFont(H3Font* pFont)
+    {
+        auto bExtFontExisted = FontMap.contains(pFont);
+        if (bExtFontExisted)
+        {
+            return FontMap[pFont];
+        }
+
+        for (size_t i = 0; i < 9; i++)
+        {
+            if (!_stricmp(g_ExtFontTable[i]->ASCIIFontName.c_str(), pFont->GetName()))
+            {
+                FontMap[pFont] = g_ExtFontTable[i];
+                return g_ExtFontTable[i];
+            }
+        }
+
+        return g_ExtFontTable[1];
+    }
+
+    DWORD __fastcall GetColor16(const H3BasePalette565& palette, int colorIdx)
+    {
+        return palette.color[colorIdx].GetRGB888();
+    }
+
+    DWORD __fastcall GetColor32(const H3BasePalette565& palette, int colorIdx)
+    {
+        return palette.palette32->colors[colorIdx];
+    }
+
+    DWORD(__fastcall* GetColor)(const H3BasePalette565& palette, int colorIdx);
+
+    void __fastcall DrawPixcel16(const PUINT8 rowBuffer, int col, DWORD color)
+    {
+        *((WORD*)rowBuffer + col) = PackRgb565(color);
+    }
+
+    void __fastcall DrawPixcel32(const PUINT8 rowBuffer, int col, DWORD color)
+    {
+        *((DWORD*)rowBuffer + col) = color;
+    }
+
+    void(__fastcall* DrawPixcel)(const PUINT8 rowBuffer, int col, DWORD color);
+
+    void __fastcall BlendPixcel16(const PUINT8 rowBuffer, int col, DWORD color, uint8_t alpha)
+    {
+        WORD* pPixel = (WORD*)rowBuffer + col;
+        *pPixel = BlendPixel565(*pPixel, color, alpha, GammaBlending ? &TextGamma : nullptr);
+    }
+
+    void __fastcall BlendPixcel32(const PUINT8 rowBuffer, int col, DWORD color, uint8_t alpha)
+    {
+        DWORD* pPixel = (DWORD*)rowBuffer + col;
+        *pPixel = BlendPixel888(*pPixel, color, alpha, GammaBlending ? &TextGamma : nullptr);
+    }
+
+    void(__fastcall* BlendPixcel)(const PUINT8 rowBuffer, int col, DWORD color, uint8_t alpha);
+
+    void __fastcall BlendRow16(const PUINT8 rowBuffer, int col, const uint8_t* pCoverage, int nCount, DWORD color)
+    {
+        BlendRow565((uint16_t*)rowBuffer + col, pCoverage, nCount, color);
+    }
+
+    void __fastcall BlendRow32(const PUINT8 rowBuffer, int col, const uint8_t* pCoverage, int nCount, DWORD color)
+    {
+        BlendRow888((uint32_t*)rowBuffer + col, pCoverage, nCount, color);
+    }
+
+    // 伽马校正逐像素查表
+    void __fastcall BlendRowGamma(const PUINT8 rowBuffer, int col, const uint8_t* pCoverage, int nCount, DWORD color)
+    {
+        for (int i = 0; i < nCount; ++i)
+        {
+            if (pCoverage[i])
+            {
+                BlendPixcel(rowBuffer, col + i, color, pCoverage[i]);
+            }
+        }
+    }
+
+    void(__fastcall* BlendRow)(const PUINT8 rowBuffer, int col, const uint8_t* pCoverage, int nCount, DWORD color);
+
+    /**
+     * @brief 绘制像素，超出绘制目标的像素将被裁剪
+     * @param surface 绘制目标
+     * @param nX X坐标
+     * @param nY Y坐标
+     * @param color RGB颜色码
+     * @param alpha 覆盖度，255时覆盖背景
+     */
+    inline void PutPixcel(TextSurface& surface, int nX, int nY, DWORD color, uint8_t alpha = 255)
+    {
+        int nCol = nX - surface.nOriginX;
+        int nRow = nY - surface.nOriginY;
+        if ((unsigned)nCol >= (unsigned)surface.nWidth || (unsigned)nRow >= (unsigned)surface.nHeight)
+        {
+            surface.bOverflow = true;
+            return;
+        }
+
+        PUINT8 pRowBuffer = surface.pBuffer + nRow * surface.nPitch;
+        if (!surface.pMask)
+        {
+            alpha == 255 ? DrawPixcel(pRowBuffer, nCol, color) : BlendPixcel(pRowBuffer, nCol, color, alpha);
+            return;
+        }
+
+        // 离屏绘制时背景未知，部分覆盖的像素记录颜色与覆盖度，重叠时按覆盖关系合成
+        uint8_t& nCoverage = surface.pMask[nRow * surface.nWidth + nCol];
+        if (alpha == 255 || nCoverage == 0)
+        {
+            DrawPixcel(pRowBuffer, nCol, color);
+            nCoverage = alpha;
+        }
+        else if (nCoverage == 255)
+        {
+            BlendPixcel(pRowBuffer, nCol, color, alpha);
+        }
+        else
+        {
+            int nResult = alpha + nCoverage * (255 - alpha) / 255;
+            BlendPixcel(pRowBuffer, nCol, color, (uint8_t)(alpha * 255 / nResult));
+            nCoverage = (uint8_t)nResult;
+        }
+    }
+
+    /**
+     * @brief 字符画的绘制层，按阴影、描边、文字的顺序绘制
+     */
+    enum class GlyphPlane
+    {
+        Shadow,
+        Outline,
+        Text
+    };
+
+    /**
+     * @brief 绘制字符画的阴影、描边或文字 H3中文: 0x532230 0x40C5B3
+     * 英文字符与汉字共用，直接绘制时按可见范围整行裁剪
+     * @tparam TPlane 绘制层，开启混合时按覆盖度与背景混合
+     * @param surface 绘制目标
+     * @param glyph 字符画
+     * @param nX 绘制位置左上角X坐标
+     * @param nY 绘制位置左上角Y坐标
+     * @param pShades 文字颜色的色阶表
+     */
+    template <GlyphPlane TPlane>
+    void __fastcall DrawGlyph(TextSurface& surface, const GlyphBitmap& glyph, int nX, int nY, const DWORD* pShades)
+    {
+        constexpr bool TText = TPlane == GlyphPlane::Text;
+        const uint8_t* pPlane = TPlane == GlyphPlane::Shadow    ? glyph.Shadow
+                                : TPlane == GlyphPlane::Outline ? glyph.Outline
+                                                                : glyph.Coverage;
+        if (!pPlane)
+        {
+            return;
+        }
+
+        int nLeft = nX + glyph.OffsetX - surface.nOriginX;
+        int nTop = nY + glyph.OffsetY - surface.nOriginY;
+        bool bBlend = TextBlending;
+        // 行内图标逐像素取色，不能整行混合
+        const uint32_t* pColors = TText ? glyph.Colors : nullptr;
+        DWORD blendColor = TPlane == GlyphPlane::Shadow    ? ShadowColor
+                           : TPlane == GlyphPlane::Outline ? glyph.OutlineColor
+                                                           : pShades[255];
+
+        // 离屏绘制逐像素记录覆盖度与溢出，不裁剪；直接绘制时只遍历可见范围
+        GlyphClip clip{0, glyph.Height, 0, glyph.Width};
+        if (!surface.pMask)
+        {
+            clip = ClipGlyph(nLeft, nTop, glyph.Width, glyph.Height, surface.nWidth, surface.nHeight);
+            if (clip.IsEmpty())
+            {
+                return;
+            }
+        }
+        if (bBlend && !surface.pMask && !pColors)
+        {
+            for (int nRow = clip.nFirstRow; nRow < clip.nLastRow; ++nRow)
+            {
+                BlendRow(surface.pBuffer + (nTop + nRow) * surface.nPitch, nLeft + clip.nFirstColumn,
+                         pPlane + nRow * glyph.Width + clip.nFirstColumn, clip.nLastColumn - clip.nFirstColumn,
+                         blendColor);
+            }
+            return;
+        }
+
+        for (int nRow = clip.nFirstRow; nRow < clip.nLastRow; ++nRow)
+        {
+            const uint8_t* pPixels = pPlane + nRow * glyph.Width;
+            PUINT8 pRowBuffer = surface.pBuffer + (nTop + nRow) * surface.nPitch;
+            for (int nColumn = clip.nFirstColumn; nColumn < clip.nLastColumn; ++nColumn)
+            {
+                uint8_t nPixel = pPixels[nColumn];
+                // 不混合时柔和阴影、描边与图标边缘按一半覆盖度取舍
+                if (!nPixel || ((!TText || pColors) && !bBlend && nPixel < 128))
+                {
+                    continue;
+                }
+
+                DWORD color = pColors ? pColors[nRow * glyph.Width + nColumn]
+                              : TText ? pShades[bBlend ? 255 : nPixel]
+                                      : blendColor;
+                if (surface.pMask)
+                {
+                    PutPixcel(surface, nX + glyph.OffsetX + nColumn, nY + glyph.OffsetY + nRow, color,
+                              bBlend ? nPixel : 255);
+                    continue;
+                }
+                bBlend && nPixel != 255 ? BlendPixcel(pRowBuffer, nLeft + nColumn, color, nPixel)
+                                        : DrawPixcel(pRowBuffer, nLeft + nColumn, color);
+            }
+        }
+    }
+
     /**
-     * @brief 获取英文字体和汉字库字体映射
-     * @param pFont 英文字体
-     * @return 汉字字库字体
+     * @brief 依次绘制全部字符的阴影、描边与文字，阴影与描边不会覆盖相邻字符的文字
+     * 阴影颜色相同，阴影之间的顺序不影响结果；描边与文字按命令顺序绘制
+     * @param surface 绘制目标
+     * @param commands 字符命令
+     * @param nBandTop 只绘制与该范围相交的字符
+     * @param nBandBottom 只绘制与该范围相交的字符
      */
-    ExtFont* __fastcall GetMappedExtFont(H3Font* pFont)
+    void __fastcall DrawGlyphCommands(TextSurface& surface, const vector<GlyphDrawCommand>& commands,
+                                      int nBandTop = INT_MIN, int nBandBottom = INT_MAX)
     {
-        auto bExtFontExisted = FontMap.contains(pFont);
-        if (bExtFontExisted)
+        auto intersects = [&](const GlyphDrawCommand& command) {
+            return IntersectsGlyphBand(command.nY + command.pGlyph->OffsetY, command.pGlyph->Height, nBandTop,
+                                       nBandBottom);
+        };
+        for (const GlyphDrawCommand& command : commands)
         {
-            return FontMap[pFont];
+            if (intersects(command))
+            {
+                DrawGlyph<GlyphPlane::Shadow>(surface, *command.pGlyph, command.nX, command.nY, command.pShades);
+            }
         }
-
-        for (size_t i = 0; i < 9; i++)
+        for (const GlyphDrawCommand& command : commands)
         {
-            if (!_stricmp(g_ExtFontTable[i]->ASCIIFontName.c_str(), pFont->GetName()))
+            if (command.pGlyph->Outline && intersects(command))
             {
-                FontMap[pFont] = g_ExtFontTable[i];
-                return g_ExtFontTable[i];
+                DrawGlyph<GlyphPlane::Outline>(surface, *command.pGlyph, command.nX, command.nY, command.pShades);
+            }
+        }
+        for (const GlyphDrawCommand& command : commands)
+        {
+            if (intersects(command))
+            {
+                DrawGlyph<GlyphPlane::Text>(surface, *command.pGlyph, command.nX, command.nY, command.pShades);
             }
         }
-
-        return g_ExtFontTable[1];
     }
 
-    DWORD __fastcall GetColor16(const H3BasePalette565& palette, int colorIdx)
+    /**
+     * @brief 获取字符绘制范围，包含阴影
+     * @param command 字符命令
+     * @return 绘制范围 左、上、右、下
+     */
+    array<int, 4> __fastcall GetGlyphRect(const GlyphDrawCommand& command)
     {
-        return palette.color[colorIdx].GetRGB888();
+        int nLeft = command.nX + command.pGlyph->OffsetX;
+        int nTop = command.nY + command.pGlyph->OffsetY;
+        return {nLeft, nTop, nLeft + command.pGlyph->Width, nTop + command.pGlyph->Height};
     }
 
-    DWORD __fastcall GetColor32(const H3BasePalette565& palette, int colorIdx)
+    /**
+     * @brief 绘制字符命令，字符数量超过阈值时按水平行带并行绘制
+     * 每个行带绘制与其相交的全部字符并裁剪到行带内，行带互不重叠，结果与顺序绘制一致
+     * @param surface 绘制目标
+     * @param commands 字符命令
+     */
+    void __fastcall RasterizeGlyphs(TextSurface& surface, const vector<GlyphDrawCommand>& commands)
     {
-        return palette.palette32->colors[colorIdx];
+        int nTop = surface.nOriginY + surface.nHeight;
+        int nBottom = surface.nOriginY;
+        if (ParallelGlyphThreshold && commands.size() >= ParallelGlyphThreshold && !surface.pMask)
+        {
+            for (const GlyphDrawCommand& command : commands)
+            {
+                array<int, 4> rect = GetGlyphRect(command);
+                nTop = min(nTop, rect[1]);
+                nBottom = max(nBottom, rect[3]);
+            }
+            nTop = max(nTop, surface.nOriginY);
+            nBottom = min(nBottom, surface.nOriginY + surface.nHeight);
+        }
+
+        bool bBanded = DrawGlyphBands(GetWorkerPool(), nTop, nBottom, [&](int nBandTop, int nBandBottom) {
+            TextSurface band = surface;
+            band.pBuffer += (nBandTop - surface.nOriginY) * surface.nPitch;
+            band.nOriginY = nBandTop;
+            band.nHeight = nBandBottom - nBandTop;
+            DrawGlyphCommands(band, commands, nBandTop, nBandBottom);
+        });
+        if (!bBanded)
+        {
+            DrawGlyphCommands(surface, commands);
+        }
     }
 
-    DWORD(__fastcall* GetColor)(const H3BasePalette565& palette, int colorIdx);
+    /**
+     * @brief 读取字宽 H3中文: 0x403ABC 0x5331A0
+     * @param pFont ASCII字体
+     * @param cFont 扩展字体
+     * @param nChar 字符代码
+     * @return
+     */
+    template <typename TEncoding>
+    int __fastcall GetFontCharWidth(H3Font* pFont, ExtFont* cFont, uint8_t nChar)
+    {
+        if (!IsLeadByte<TEncoding>(nChar))
+        {
+            return pFont->width[nChar].leftMargin + pFont->width[nChar].span + pFont->width[nChar].rightMargin;
+        }
+        else
+        {
+            return cFont->MarginLeft + cFont->Width + cFont->MarginRight;
+        }
+    }
 
-    void __fastcall DrawPixcel16(const PUINT8 rowBuffer, int col, DWORD color)
+    /**
+     * @brief 读取单个字符的字宽与字节数，颜色标记 {~...} 与其他标记不占宽度，行内图标整体为一个字符
+     * @param pFont ASCII字体
+     * @param cFont 扩展字体
+     * @param text 文本
+     * @param nPos 字符位置
+     * @param nCharLength 输出字符字节数，多字节字符不完整时为1
+     * @return 字宽
+     */
+    template <typename TEncoding>
+    int __fastcall GetCharAdvance(H3Font* pFont, ExtFont* cFont, string_view text, size_t nPos, size_t& nCharLength)
     {
-        *((WORD*)rowBuffer + col) = (WORD)color;
+        uint8_t currentChar = text[nPos];
+        nCharLength = 1;
+        if (Cmpt_TextColor && currentChar == '{' && nPos + 1 < text.length() && text[nPos + 1] == '~')
+        {
+            nCharLength = min(text.find('}', nPos), text.length() - 1) + 1 - nPos;
+            return 0;
+        }
+        if (currentChar == '{')
+        {
+            int nIcon = ParseIconMarkup(text, nPos, nCharLength);
+            return nIcon >= 0 ? cFont->GetIconAdvance(nIcon) : 0;
+        }
+        if (currentChar == '}')
+        {
+            return 0;
+        }
+        nCharLength = GetValidCharLength<TEncoding>((const uint8_t*)text.data() + nPos, text.length() - nPos);
+        return GetFontCharWidth<TEncoding>(pFont, cFont, currentChar);
     }
 
-    void __fastcall DrawPixcel32(const PUINT8 rowBuffer, int col, DWORD color)
+    void __fastcall BuildBreakClasses()
     {
-        *((DWORD*)rowBuffer + col) = color;
+        // 避头：右括号、右引号、标点、长音与日文小假名
+        static const wchar_t noStart[] = L"!%),.:;?]"
+                                         L"！％），．：；？］｝、。〉》」』】〕〗〙〛‐–—…‥·・～’”°′″℃"
+                                         L"｡､｣ーｰ々ゝゞヽヾぁぃぅぇぉっゃゅょゎァィゥェォッャュョヮヵヶ";
+        // 避尾：左括号、左引号、货币符号
+        static const wchar_t noEnd[] = L"([（［｛〈《「『【〔〖〘〚‘“＄￥￡｢";
+        // 悬挂：逗号、句号
+        static const wchar_t hanging[] = L"，．、。､｡";
+
+        array<uint8_t, 0x10000> classes{};
+        for (wchar_t code : wstring_view(noStart))
+        {
+            classes[code] |= LineBreakRules ? BreakNoStart : 0;
+        }
+        for (wchar_t code : wstring_view(noEnd))
+        {
+            classes[code] |= LineBreakRules ? BreakNoEnd : 0;
+        }
+        for (wchar_t code : wstring_view(hanging))
+        {
+            classes[code] |= LineBreakRules ? BreakHanging : 0;
+        }
+
+        // 单词：数字、拉丁字母（含扩展）、希腊字母、西里尔字母与撇号，连字符只允许在其后换行
+        static const pair<int, int> wordRanges[] = {{'0', '9'},      {'A', 'Z'},       {'a', 'z'},
+                                                    {'\'', '\''},    {0x00C0, 0x024F}, {0x0370, 0x03FF},
+                                                    {0x0400, 0x04FF}};
+        for (auto [nFirst, nLast] : wordRanges)
+        {
+            for (int code = nFirst; WordWrap && code <= nLast; ++code)
+            {
+                classes[code] |= code == 0xD7 || code == 0xF7 ? 0 : BreakWord;
+            }
+        }
+        classes[' '] |= WordWrap ? BreakSpace : 0;
+        classes['-'] |= WordWrap ? BreakNoStart : 0;
+
+        copy_n(classes.begin(), 128, AsciiBreakClasses.begin());
+        GlyphBreakClasses.assign(CurrentEncoding.GetGlyphCount(), 0);
+        for (int i = 0; i < CurrentEncoding.GetGlyphCount(); ++i)
+        {
+            int nCodePoint = CurrentEncoding.Unicode ? i : GetGlyphCodePoint(i);
+            GlyphBreakClasses[i] = (unsigned)nCodePoint < classes.size() ? classes[nCodePoint] : 0;
+        }
     }
 
-    void(__fastcall* DrawPixcel)(const PUINT8 rowBuffer, int col, DWORD color);
+    /**
+     * @brief 读取字符的换行类别
+     * @param pChar 字符
+     * @param nCharLength 字符有效长度，参考 GetValidCharLength
+     * @return 换行类别，参考 BreakClass
+     */
+    template <typename TEncoding>
+    inline uint8_t GetBreakClass(const uint8_t* pChar, int nCharLength)
+    {
+        if (!IsLeadByte<TEncoding>(*pChar))
+        {
+            return AsciiBreakClasses[*pChar];
+        }
+        int nIndex = nCharLength > 1 ? GetGlyphIndex<TEncoding>(pChar) : -1;
+        return (unsigned)nIndex < GlyphBreakClasses.size() ? GlyphBreakClasses[nIndex] : 0;
+    }
 
     /**
-     * @brief 绘制文字 H3中文: 0x532230 0x40C5B3
-     * @tparam T 彩色模式类型 仅支持 16位色、32位色
+     * @brief 拆分行
      * @param pFont ASCII字体
      * @param cFont 扩展字体
-     * @param pOutputPcx 图像输出
-     * @param nCode1 字符编码高位
-     * @param nCode2 字符编码低位
-     * @param nX 绘制位置左上角X坐标
-     * @param nY 绘制位置左上角Y坐标
-     * @param nFontColor RGB颜色码
-     * @param nShadowColor 阴影RGB颜色码
-     * @return
+     * @param text 文本
+     * @param nWidth 行宽
+     * @param textLines 文本行
+     * @param stringVector H3文本行
+     * @param nStartOffset 起始拆分位置，必须位于行首
+     * @param pSameSplitWidth 输出拆分结果不变的最小行宽：行宽只参与比较，[该值, nWidth] 内每次比较的结果均相同
+     * @return 总行数
      */
-    bool __fastcall DrawTextChar(H3Font* pFont, ExtFont* cFont, H3LoadedPcx16* pOutputPcx, uint8_t nCode1,
-                                 uint8_t nCode2, int nX, int nY, DWORD nFontColor)
+    template <typename TEncoding>
+    int __fastcall SplitTextToLines(H3Font* pFont, ExtFont* cFont, string_view text, int nWidth,
+                                    vector<TextLineStruct>* textLines, H3Vector<H3String>* stringVector,
+                                    size_t nStartOffset = 0, int* pSameSplitWidth = nullptr)
     {
-        // 绘制英文文字
-        if (nCode2 == 0)
+        // 与行宽比较后未超出的最大宽度
+        int nFitWidth = 0;
+        if (pSameSplitWidth)
+        {
+            *pSameSplitWidth = 0;
+        }
+        if (text.empty())
+        {
+            return 0;
+        }
+
+        int lineCount = 0;
+        int currentLineWidth = 0;
+        // 启用换行规则时颜色标记不参与拆分
+        const bool bBreakRules = LineBreakRules || WordWrap;
+        for (size_t sectionBegin = nStartOffset; sectionBegin <= text.length();)
         {
-            PUINT8 pFontBuffer = pFont->GetChar(nCode1);
-            int startX = nX + pFont->width[nCode1].leftMargin;
-            int startY = nY;
-            for (int nRow = 0; nRow < pFont->height; ++nRow)
+            size_t sectionEnd = min(text.find('\n', sectionBegin), text.length());
+            string_view pLine = text.substr(sectionBegin, sectionEnd - sectionBegin);
+            sectionBegin = sectionEnd + 1;
+
+            int strLength = pLine.length();
+            if (strLength == 0)
+            {
+                ++lineCount;
+                if (textLines)
+                {
+                    textLines->push_back(TextLineStruct{pLine, 0});
+                }
+                if (stringVector)
+                {
+                    stringVector->Add("");
+                }
+                continue;
+            }
+
+            // 添加 [stringSubIndex, nLineEnd) 为一行
+            int stringSubIndex = 0;
+            // 当前位置之前连续空格的宽度，行尾空格不计入行宽
+            int spaceWidth = 0;
+            auto addLine = [&](int nLineEnd, int nLineWidth) {
+                ++lineCount;
+                if (textLines)
+                {
+                    textLines->push_back(TextLineStruct{pLine.substr(stringSubIndex, nLineEnd - stringSubIndex),
+                                                        nLineEnd - stringSubIndex, nLineWidth});
+                }
+                if (stringVector)
+                {
+                    stringVector->Add(H3String(pLine.substr(stringSubIndex, nLineEnd - stringSubIndex).data(),
+                                               nLineEnd - stringSubIndex));
+                }
+                stringSubIndex = nLineEnd;
+            };
+
+            int colorMark = false;
+            // 最近一个允许换行的位置、该位置之前的行宽（不含行尾空格）与累计宽度，超宽时回退到该位置，不重新扫描
+            int breakIndex = 0;
+            int breakWidth = 0;
+            int breakAdvance = 0;
+            uint8_t prevClass = 0;
+            // 连续普通ASCII字符的结尾，其中的字符不需要判断标记与多字节字符
+            int nPlainEnd = 0;
+            for (int i = 0; i < strLength; ++i)
             {
-                for (int nColumn = 0; nColumn < pFont->width[nCode1].span; ++nColumn)
+                uint8_t currentChar = pLine[i];
+                int charWidth = 0;
+
+                if (i >= nPlainEnd && !colorMark && IsPlainAscii(currentChar))
+                {
+                    nPlainEnd = i + (int)CountPlainAsciiRun((const uint8_t*)pLine.data() + i, strLength - i);
+                }
+                const bool bPlain = i < nPlainEnd;
+
+                if (Cmpt_TextColor && !bPlain)
                 {
-                    uint8_t nPixcel = *pFontBuffer++;
-                    if (!nPixcel)
+                    if (colorMark)
+                    {
+                        if (currentChar == '}')
+                        {
+                            colorMark = false;
+                        }
+                        continue;
+                    }
+
+                    if (currentChar == '{' && i + 1 < strLength && pLine[i + 1] == '~')
                     {
+                        colorMark = true;
                         continue;
                     }
+                }
+
+                // 行内图标整体按一个字符排版
+                size_t nIconLength = 1;
+                int nIcon = -1;
+                bool bMarkup = false;
+                int nCharLength = 1;
+                uint8_t breakClass = 0;
+                if (bPlain)
+                {
+                    charWidth = GetFontCharWidth<TEncoding>(pFont, cFont, currentChar);
+                    breakClass = AsciiBreakClasses[currentChar];
+                }
+                else
+                {
+                    nIcon = currentChar == '{' ? ParseIconMarkup(pLine, i, nIconLength) : -1;
+                    bMarkup = nIcon < 0 && (currentChar == '{' || currentChar == '}');
+                    if (nIcon >= 0)
+                    {
+                        charWidth = cFont->GetIconAdvance(nIcon);
+                    }
+                    else if (!bMarkup)
+                    {
+                        charWidth = GetFontCharWidth<TEncoding>(pFont, cFont, currentChar);
+                    }
+
+                    const uint8_t* pChar = (const uint8_t*)pLine.data() + i;
+                    nCharLength =
+                        IsLeadByte<TEncoding>(currentChar) ? GetValidCharLength<TEncoding>(pChar, strLength - i) : 1;
+                    // 颜色标记不参与换行判断
+                    breakClass = !bMarkup && nIcon < 0 ? GetBreakClass<TEncoding>(pChar, nCharLength) : 0;
+                }
+                bool bBreakable = !(prevClass & BreakNoEnd) && !(breakClass & BreakNoStart) &&
+                                  !(prevClass & breakClass & BreakWord);
+                if (bBreakable && !bMarkup)
+                {
+                    breakIndex = i;
+                    breakWidth = currentLineWidth - spaceWidth;
+                    breakAdvance = currentLineWidth;
+                }
 
-                    // 255表示绘制正常颜色，否则则绘制阴影
-                    if (nPixcel == 255)
+                if (currentLineWidth + charWidth <= nWidth)
+                {
+                    nFitWidth = max(nFitWidth, currentLineWidth + charWidth);
+                }
+                // 行首字符即使超宽也不拆分，避免产生空行
+                if (currentLineWidth + charWidth > nWidth && i > stringSubIndex && !(bBreakRules && bMarkup))
+                {
+                    if (breakClass & BreakSpace)
+                    {
+                        // 空格悬挂于行尾，下一个字符处换行
+                        currentLineWidth += charWidth;
+                    }
+                    else if (bBreakable)
+                    {
+                        addLine(i, currentLineWidth - spaceWidth);
+                        currentLineWidth = charWidth;
+                    }
+                    else if (HangingPunctuation && (breakClass & BreakHanging) && currentLineWidth <= nWidth)
+                    {
+                        // 标点悬挂于行尾，下一个字符处换行
+                        nFitWidth = max(nFitWidth, currentLineWidth);
+                        currentLineWidth += charWidth;
+                    }
+                    else if (breakIndex > stringSubIndex && currentLineWidth + charWidth - breakAdvance <= nWidth)
                     {
-                        DrawPixcel(pOutputPcx->GetRow(startY + nRow), startX + nColumn, nFontColor);
+                        nFitWidth = max(nFitWidth, currentLineWidth + charWidth - breakAdvance);
+                        // 回退到上一个允许换行的位置，其后的字符移到下一行
+                        addLine(breakIndex, breakWidth);
+                        currentLineWidth += charWidth - breakAdvance;
+                        // 下一行开头的空格不计入上一行
+                        spaceWidth = min(spaceWidth, currentLineWidth - charWidth);
                     }
                     else
                     {
-                        DrawPixcel(pOutputPcx->GetRow(startY + nRow), startX + nColumn, ShadowColor);
+                        // 没有允许换行的位置，或回退后下一行仍然超宽时，在超宽处拆分
+                        addLine(i, currentLineWidth - spaceWidth);
+                        currentLineWidth = charWidth;
                     }
                 }
+                else
+                {
+                    currentLineWidth += charWidth;
+                }
+
+                if (!bMarkup)
+                {
+                    prevClass = breakClass;
+                    spaceWidth = breakClass & BreakSpace ? spaceWidth + charWidth : 0;
+                }
+                i += nCharLength - 1;
+                i += nIconLength - 1;
             }
 
-            return false;
+            if (strLength - stringSubIndex > 0)
+            {
+                addLine(strLength, currentLineWidth);
+            }
+
+            currentLineWidth = 0;
         }
 
-        // 绘制汉字文字
+        if (pSameSplitWidth)
+        {
+            *pSameSplitWidth = nFitWidth;
+        }
+        return lineCount;
+    }
+
+    /**
+     * @brief 均衡行宽，求保持最大行宽下行数不变的最小文本框宽度，按该宽度拆分时各行长度接近，避免末行仅剩一两个字
+     * @param pFont ASCII字体
+     * @param cFont 扩展字体
+     * @param text 文本字符串
+     * @param nMinWidth 最小行宽
+     * @param nMaxWidth 最大行宽
+     * @return 文本框宽度
+     */
+    template <typename TEncoding>
+    int __fastcall GetBalancedLineWidth(H3Font* pFont, ExtFont* cFont, string_view text, int nMinWidth, int nMaxWidth)
+    {
+        return GetMinimumSplitWidth(nMinWidth, nMaxWidth, [&](int nWidth, int& nSameSplitWidth) {
+            return SplitTextToLines<TEncoding>(pFont, cFont, text, nWidth, nullptr, nullptr, 0, &nSameSplitWidth);
+        });
+    }
+
+    /**
+     * @brief 按换行符拆分行，超出行宽的行截断到省略号仍能放下的最后一个字符边界，每行只测量一遍
+     * @param pFont ASCII字体
+     * @param cFont 扩展字体
+     * @param text 文本
+     * @param nWidth 行宽
+     * @param nEllipsisWidth 省略号宽度
+     * @param textLines 文本行
+     */
+    template <typename TEncoding>
+    void __fastcall TruncateTextToLines(H3Font* pFont, ExtFont* cFont, string_view text, int nWidth,
+                                        int nEllipsisWidth, vector<TextLineStruct>& textLines)
+    {
+        if (text.empty())
+        {
+            return;
+        }
 
-        // 左边距为1，对齐Y中轴
-        int startX = nX + cFont->MarginLeft;
-        int startY = nY;
-        PUINT8 pFontFileBuffer = cFont->GetHzkCharacterPcxPointer(nCode1, nCode2);
-        for (int nRow = 0; nRow < cFont->Height; ++nRow)
+        for (size_t sectionBegin = 0; sectionBegin <= text.length();)
         {
-            for (int nColumn = 0; nColumn < cFont->Width; ++nColumn)
+            size_t sectionEnd = min(text.find('\n', sectionBegin), text.length());
+            string_view pLine = text.substr(sectionBegin, sectionEnd - sectionBegin);
+            sectionBegin = sectionEnd + 1;
+
+            // 最后一个可以截断的位置及其之前的行宽
+            size_t fitIndex = 0;
+            int fitWidth = 0;
+            int currentLineWidth = 0;
+            for (size_t i = 0; i < pLine.length();)
             {
-                uint8_t alpha = *(pFontFileBuffer + (cFont->Height * nRow + nColumn));
-                if (alpha == 0)
+                if (currentLineWidth + nEllipsisWidth <= nWidth)
                 {
-                    continue;
+                    fitIndex = i;
+                    fitWidth = currentLineWidth;
                 }
+                size_t nCharLength = 1;
+                currentLineWidth += GetCharAdvance<TEncoding>(pFont, cFont, pLine, i, nCharLength);
+                i += nCharLength;
+            }
 
-                auto rgbFontColor = H3ARGB888(nFontColor);
-                rgbFontColor.Darken(-alpha);
-                DrawPixcel(pOutputPcx->GetRow(startY + nRow), startX + nColumn, rgbFontColor.Value());
-                // 是否绘制阴影
-                if (!cFont->DrawShadow)
-                {
-                    continue;
-                }
-                // 绘制阴影
-                DrawPixcel(pOutputPcx->GetRow(startY + nRow + 1), startX + nColumn + 1, ShadowColor);
+            if (currentLineWidth <= nWidth)
+            {
+                textLines.push_back(TextLineStruct{pLine, (int)pLine.length(), currentLineWidth});
+            }
+            else
+            {
+                textLines.push_back(TextLineStruct{pLine.substr(0, fitIndex), (int)fitIndex,
+                                                   fitWidth + nEllipsisWidth, true});
+            }
+        }
+    }
+
+    /**
+     * @brief 排版文本，文本控件重绘时复用与上次文本相同前缀的稳定行
+     * @param pFont ASCII字体
+     * @param cFont 扩展字体
+     * @param pStr 文本字符串
+     * @param nWidth 行宽
+     * @param textLines 无法增量排版时使用的文本行容器
+     * @return 文本行
+     */
+    template <typename TEncoding>
+    const vector<TextLineStruct>& __fastcall LayoutTextLines(H3Font* pFont, ExtFont* cFont, LPCSTR pStr, int nWidth,
+                                                             vector<TextLineStruct>& textLines)
+    {
+        if (!IncrementalLayout || !CurrentDlgText)
+        {
+            SplitTextToLines<TEncoding>(pFont, cFont, pStr, nWidth, &textLines, nullptr);
+            return textLines;
+        }
+
+        if (TextLayoutMap.size() >= MaxTextLayoutStates && !TextLayoutMap.contains(CurrentDlgText))
+        {
+            TextLayoutMap.clear();
+        }
+
+        TextLayoutState& state = TextLayoutMap[CurrentDlgText];
+        string_view text = pStr;
+
+        size_t stableLength = 0;
+        if (state.pFont == pFont && state.nWidth == nWidth)
+        {
+            stableLength = mismatch(state.text.begin(), state.text.end(), text.begin(), text.end()).first -
+                           state.text.begin();
+            if (stableLength == state.text.length() && stableLength == text.length())
+            {
+                return state.textLines;
+            }
+        }
+
+        // 行尾字符及其后一个字符（颜色标记、汉字低位）决定了拆分位置，均处于相同前缀内的行才可复用
+        // 避头尾、单词回退与悬挂标点还取决于下一行开头的字符，最后一个稳定行也重新拆分
+        vector<size_t> stableOffsets;
+        for (const TextLineStruct& line : state.textLines)
+        {
+            size_t lineBegin = line.pText.data() - state.text.data();
+            size_t lineEnd = lineBegin + line.nStrLength;
+            if (lineEnd + 2 > stableLength)
+            {
+                break;
             }
+            stableOffsets.push_back(lineBegin);
+        }
+        size_t resumeOffset = 0;
+        if ((LineBreakRules || WordWrap) && !stableOffsets.empty())
+        {
+            resumeOffset = stableOffsets.back();
+            stableOffsets.pop_back();
+        }
+        else if (!stableOffsets.empty())
+        {
+            const TextLineStruct& line = state.textLines[stableOffsets.size() - 1];
+            size_t lineEnd = stableOffsets.back() + line.nStrLength;
+            resumeOffset = state.text[lineEnd] == '\n' ? lineEnd + 1 : lineEnd;
+        }
+
+        state.pFont = pFont;
+        state.nWidth = nWidth;
+        state.text.assign(text);
+        state.textLines.resize(stableOffsets.size());
+        // 稳定行重新指向新文本
+        for (size_t i = 0; i < stableOffsets.size(); ++i)
+        {
+            TextLineStruct& line = state.textLines[i];
+            line.pText = string_view(state.text).substr(stableOffsets[i], line.nStrLength);
+        }
+
+        SplitTextToLines<TEncoding>(pFont, cFont, state.text, nWidth, &state.textLines, nullptr, resumeOffset);
+        return state.textLines;
+    }
+
+    int CaretIndex::Snap(size_t nOffset, bool bForward) const
+    {
+        if (nOffset >= text.length())
+        {
+            return text.length();
         }
-
-        return true;
+        int nStart = Starts[nOffset];
+        if (nStart == (int)nOffset || !bForward)
+        {
+            return nStart;
+        }
+        return *upper_bound(Boundaries.begin(), Boundaries.end(), nStart);
     }
 
-    /**
-     * @brief 读取字宽 H3中文: 0x403ABC 0x5331A0
-     * @param pFont ASCII字体
-     * @param cFont 扩展字体
-     * @param nChar 字符代码
-     * @return
-     */
-    int __fastcall GetFontCharWidth(H3Font* pFont, ExtFont* cFont, uint8_t nChar)
+    int CaretIndex::HitTest(int nX) const
     {
-        if (nChar < 160)
+        // 第一个累计宽度大于坐标的字符边界，与前一个边界比较距离
+        auto it = upper_bound(Boundaries.begin(), Boundaries.end(), nX,
+                              [this](int x, int nBoundary) { return x < Advances[nBoundary]; });
+        if (it == Boundaries.begin())
         {
-            return pFont->width[nChar].leftMargin + pFont->width[nChar].span + pFont->width[nChar].rightMargin;
+            return 0;
         }
-        else
+        if (it == Boundaries.end())
         {
-            return cFont->MarginLeft + cFont->Width + cFont->MarginRight;
+            return text.length();
         }
+        int nRight = *it;
+        int nLeft = *(it - 1);
+        return nX - Advances[nLeft] < Advances[nRight] - nX ? nLeft : nRight;
     }
 
     /**
-     * @brief 拆分行
+     * @brief 获取文本框的字符前缀宽度索引，文本与字体未改变时直接复用
+     * @param pEdit 文本框
      * @param pFont ASCII字体
-     * @param cFont 扩展字体
-     * @param pStr 文本指针
-     * @param nWidth 行宽
-     * @param textLines 文本行
-     * @param textLines H3文本行
-     * @return 总行数
+     * @return 索引
      */
-    int __fastcall SplitTextToLines(H3Font* pFont, ExtFont* cFont, LPCSTR pStr, int nWidth,
-                                    vector<TextLineStruct>* textLines, H3Vector<H3String>* stringVector)
+    template <typename TEncoding>
+    CaretIndex& __fastcall GetCaretIndex(H3DlgEdit* pEdit, H3Font* pFont)
     {
-        string_view text = pStr;
-        auto sections = text | std::views::split('\n') |
-                        std::views::transform([](const auto& v) { return string_view(v.begin(), v.end()); });
+        if (CaretIndexMap.size() >= MaxTextLayoutStates && !CaretIndexMap.contains(pEdit))
+        {
+            CaretIndexMap.clear();
+        }
 
-        int lineCount = 0;
-        int currentLineWidth = 0;
-        for (const auto& pLine : sections)
+        CaretIndex& index = CaretIndexMap[pEdit];
+        string_view text = pEdit->GetText();
+        if (index.pFont == pFont && index.text == text && !index.Starts.empty())
         {
-            int strLength = pLine.length();
-            if (strLength == 0)
+            return index;
+        }
+
+        ExtFont* cFont = GetMappedExtFont(pFont);
+        index.pFont = pFont;
+        index.text.assign(text);
+        index.Starts.resize(text.length() + 1);
+        index.Advances.resize(text.length() + 1);
+        index.Boundaries.clear();
+
+        // 与拆分行相同的宽度规则
+        int nAdvance = 0;
+        for (size_t i = 0; i < text.length();)
+        {
+            size_t nCharLength = 1;
+            int charWidth = GetCharAdvance<TEncoding>(pFont, cFont, text, i, nCharLength);
+
+            index.Boundaries.push_back(i);
+            for (size_t k = i; k < i + nCharLength; ++k)
             {
-                ++lineCount;
-                if (textLines)
-                {
-                    textLines->push_back(TextLineStruct{"", 0});
-                }
-                if (stringVector)
-                {
-                    stringVector->Add("");
-                }
-                continue;
+                index.Starts[k] = i;
+                index.Advances[k] = nAdvance;
             }
+            nAdvance += charWidth;
+            i += nCharLength;
+        }
+        index.Starts.back() = text.length();
+        index.Advances.back() = nAdvance;
+        index.Boundaries.push_back(text.length());
+        return index;
+    }
 
-            int colorMark = false;
-            int stringSubIndex = 0;
-            for (int i = 0; i < strLength; ++i)
+    /**
+     * @brief 统计文本中的字符使用次数，相同文本只统计一次，统计有更新时定期在工作线程中保存
+     * @param pStr 文本字符串
+     */
+    template <typename TEncoding>
+    void __fastcall ProfileText(LPCSTR pStr)
+    {
+        string_view text = pStr;
+        if (ProfiledTexts.size() >= MaxProfiledTexts)
+        {
+            ProfiledTexts.clear();
+        }
+        if (ProfiledTexts.insert(hash<string_view>()(text)).second)
+        {
+            const uint8_t* pText = (const uint8_t*)text.data();
+            for (size_t i = 0; i < text.length(); ++i)
             {
-                uint8_t currentChar = pLine[i];
-                int charWidth = 0;
-
-                if (Cmpt_TextColor)
-                {
-                    if (colorMark)
-                    {
-                        if (currentChar == '}')
-                        {
-                            colorMark = false;
-                        }
-                        continue;
-                    }
-
-                    if (currentChar == '{' && i + 1 < strLength && pLine[i + 1] == '~')
-                    {
-                        colorMark = true;
-                        continue;
-                    }
-                }
-
-                if (currentChar != '{' && currentChar != '}')
-                {
-                    charWidth = GetFontCharWidth(pFont, cFont, currentChar);
-                }
-
-                if (currentLineWidth + charWidth > nWidth)
+                if (IsLeadByte<TEncoding>(pText[i]))
                 {
-                    ++lineCount;
-                    if (textLines)
-                    {
-                        textLines->push_back(TextLineStruct{pLine.substr(stringSubIndex, i - stringSubIndex),
-                                                            i - stringSubIndex, currentLineWidth});
-                    }
-                    if (stringVector)
+                    int nCharLength = GetValidCharLength<TEncoding>(pText + i, text.length() - i);
+                    int nIndex = nCharLength > 1 ? GetGlyphIndex<TEncoding>(pText + i) : -1;
+                    if ((unsigned)nIndex < GlyphProfile.size())
                     {
-                        stringVector->Add(
-                            H3String(pLine.substr(stringSubIndex, i - stringSubIndex).data(), i - stringSubIndex));
+                        ++GlyphProfile[nIndex];
+                        GlyphProfileDirty = true;
                     }
-                    stringSubIndex = i;
-                    currentLineWidth = charWidth;
-                }
-                else
-                {
-                    currentLineWidth += charWidth;
-                }
-
-                if (currentChar > 160 && (i + 1) <= strLength)
-                {
-                    ++i;
-                }
-            }
-
-            if (strLength - stringSubIndex > 0)
-            {
-                ++lineCount;
-                if (textLines)
-                {
-                    textLines->push_back(TextLineStruct{pLine.substr(stringSubIndex, strLength - stringSubIndex),
-                                                        strLength - stringSubIndex, currentLineWidth});
-                }
-                if (stringVector)
-                {
-                    stringVector->Add(H3String(pLine.substr(stringSubIndex, strLength - stringSubIndex).data(),
-                                               strLength - stringSubIndex));
+                    i += nCharLength - 1;
                 }
             }
-
-            currentLineWidth = 0;
         }
 
-        return lineCount;
+        auto now = chrono::steady_clock::now();
+        if (GlyphProfileDirty && now - GlyphProfileSaveTime >= GlyphProfileSaveInterval)
+        {
+            GlyphProfileDirty = false;
+            GlyphProfileSaveTime = now;
+            GetWorkerPool().Submit(
+                [fileName = GlyphProfileFile, profile = GlyphProfile] { SaveGlyphProfile(fileName, profile); });
+        }
     }
 
     /**
-     * @brief 绘制文字 H3中文: 0x4077D4 0x532BC0
+     * @brief 绘制文字到绘制目标
+     * @param surface 绘制目标
      * @param pFont ASCII字体
      * @param pStr 文本字符串
-     * @param pPcx 图像输出
      * @param nX 绘制字符位置左上角X坐标
      * @param nY 绘制字符位置左上角Y坐标
      * @param nWidth 文本框宽度
      * @param nHeight 文本框高度
      * @param nColorIdx 颜色序号，参考eTextColor定义
      * @param nAlignFlags 文本排版规则，参考eTextAlignment定义
-     * @param nFontStyle 字体风格（无用）
-     * @return
+     * @param nStyle 字符样式序号，0表示无样式
      */
-    void __stdcall TextDraw(HiHook* h, H3Font* pFont, LPCSTR pStr, H3LoadedPcx16* pPcx, int nX, int nY, int nWidth,
-                            int nHeight, uint32_t nColorIdx, uint32_t nAlignFlags, int nFontStyle)
+    template <typename TEncoding>
+    void __fastcall DrawTextToSurface(TextSurface& surface, H3Font* pFont, LPCSTR pStr, int nX, int nY, int nWidth,
+                                      int nHeight, uint32_t nColorIdx, uint32_t nAlignFlags, int nStyle)
     {
-        if (nWidth == 0)
+        // 汉字字体
+        ExtFont* cFont = GetMappedExtFont(pFont);
+        cFont->WaitFontFile();
+        if (!GlyphProfile.empty())
         {
-            return;
+            ProfileText<TEncoding>(pStr);
         }
 
-        // 根据游戏的图像模式初始化图像渲染
-        if (H3BitMode::Get() == 4)
-        {
-            GetColor = GetColor32;
-            DrawPixcel = DrawPixcel32;
-        }
-        else
+        vector<TextLineStruct> splitLines;
+        int nEllipsisGlyph = -1;
+        if (nAlignFlags & TextAlignEllipsis)
         {
-            GetColor = GetColor16;
-            DrawPixcel = DrawPixcel16;
+            nAlignFlags &= ~TextAlignEllipsis;
+            // 省略号使用扩展字体的“…”，编码中没有时使用三个句点
+            nEllipsisGlyph = GetEllipsisGlyph();
+            int nEllipsisWidth = nEllipsisGlyph >= 0 ? cFont->MarginLeft + cFont->Width + cFont->MarginRight
+                                                     : GetFontCharWidth<TEncoding>(pFont, cFont, '.') * 3;
+            TruncateTextToLines<TEncoding>(pFont, cFont, pStr, nWidth, nEllipsisWidth, splitLines);
         }
-
-        // 汉字字体
-        ExtFont* cFont = GetMappedExtFont(pFont);
-
-        vector<TextLineStruct> textLines;
-        SplitTextToLines(pFont, cFont, pStr, nWidth, &textLines, nullptr);
+        const vector<TextLineStruct>& textLines =
+            splitLines.empty() ? LayoutTextLines<TEncoding>(pFont, cFont, pStr, nWidth, splitLines) : splitLines;
 
         int startY = 0;
         // 垂直居中对齐
@@ -343,6 +1704,15 @@ namespace H3FontExtension
 
         DWORD defaultColor = GetColor(pFont->palette, nColorIdx);
         DWORD textColor = defaultColor;
+        DWORD shadeColor = textColor;
+        const DWORD* pShades = GetShadeTable(shadeColor);
+        // 传统颜色代码 {...} 内使用高亮样式
+        int nBaseStyle = nStyle;
+        int nHighlightStyle = cFont->HighlightStyle ? cFont->HighlightStyle : nBaseStyle;
+        const GlyphBitmap* pAsciiGlyphs = GetAsciiGlyphs(pFont, cFont->GetStyle(nStyle));
+
+        static vector<GlyphDrawCommand> glyphs;
+        glyphs.clear();
 
         int rowIdx = 0;
         for (const TextLineStruct& p : textLines)
@@ -405,10 +1775,29 @@ namespace H3FontExtension
                         continue;
                     }
 
+                    // 行内图标
+                    size_t nIconLength = 0;
+                    int nIcon = ParseIconMarkup(p.pText, i, nIconLength);
+                    if (nIcon >= 0)
+                    {
+                        glyphs.push_back(GlyphDrawCommand{
+                            nX + startX + posMove,
+                            nY + cfontShift + rowIdx * (std::max(pFont->height, cFont->Height) + cFont->MarginBottom),
+                            cFont->GetIconGlyph(nIcon), pShades});
+                        posMove += cFont->GetIconAdvance(nIcon);
+                        i += nIconLength - 1;
+                        continue;
+                    }
+
                     // 传统颜色代码
                     if (currentChar == '{')
                     {
                         textColor = GetColor(pFont->palette, nColorIdx + 1);
+                        if (nStyle != nHighlightStyle)
+                        {
+                            nStyle = nHighlightStyle;
+                            pAsciiGlyphs = GetAsciiGlyphs(pFont, cFont->GetStyle(nStyle));
+                        }
                     }
                     continue;
                 }
@@ -416,34 +1805,357 @@ namespace H3FontExtension
                 {
                     colorNameSubIndex = 0;
                     textColor = defaultColor;
+                    if (nStyle != nBaseStyle)
+                    {
+                        nStyle = nBaseStyle;
+                        pAsciiGlyphs = GetAsciiGlyphs(pFont, cFont->GetStyle(nStyle));
+                    }
+                    continue;
+                }
+
+                if (textColor != shadeColor)
+                {
+                    shadeColor = textColor;
+                    pShades = GetShadeTable(shadeColor);
+                }
+
+                if (IsPlainAscii(currentChar))
+                {
+                    // 连续的普通ASCII字符直接使用ASCII字符画
+                    const uint8_t* pPlain = (const uint8_t*)p.pText.data() + i;
+                    int nPlain = (int)CountPlainAsciiRun(pPlain, p.nStrLength - i);
+                    int nPlainY = nY + startY + rowIdx * (std::max(pFont->height, cFont->Height) + cFont->MarginBottom);
+                    for (int j = 0; j < nPlain; ++j)
+                    {
+                        glyphs.push_back(
+                            GlyphDrawCommand{nX + startX + posMove, nPlainY, &pAsciiGlyphs[pPlain[j]], pShades});
+                        posMove += GetFontCharWidth<TEncoding>(pFont, cFont, pPlain[j]);
+                    }
+                    i += nPlain - 1;
                     continue;
                 }
 
-                if (currentChar > 160 && (i + 1) <= p.nStrLength)
+                if (IsLeadByte<TEncoding>(currentChar))
+                {
+                    // 无效或不完整的字符绘制替换字符，只跳过首字节
+                    const uint8_t* pChar = (const uint8_t*)p.pText.data() + i;
+                    int nCharLength = GetValidCharLength<TEncoding>(pChar, p.nStrLength - i);
+                    int nIndex = nCharLength > 1 ? GetGlyphIndex<TEncoding>(pChar) : -1;
+                    glyphs.push_back(GlyphDrawCommand{
+                        nX + startX + posMove,
+                        nY + cfontShift + rowIdx * (std::max(pFont->height, cFont->Height) + cFont->MarginBottom),
+                        cFont->GetStyledGlyph(nIndex, nStyle), pShades});
+                    i += nCharLength - 1;
+                }
+                else
+                {
+                    glyphs.push_back(GlyphDrawCommand{
+                        nX + startX + posMove,
+                        nY + startY + rowIdx * (std::max(pFont->height, cFont->Height) + cFont->MarginBottom),
+                        &pAsciiGlyphs[currentChar], pShades});
+                }
+
+                posMove += GetFontCharWidth<TEncoding>(pFont, cFont, currentChar);
+            }
+
+            // 截断的行尾绘制省略号
+            if (p.bEllipsis)
+            {
+                if (textColor != shadeColor)
                 {
-                    DrawTextChar(pFont, cFont, pPcx, currentChar, p.pText[i + 1], nX + startX + posMove,
-                                 nY + cfontShift +
-                                     rowIdx * (std::max(pFont->height, cFont->Height) + cFont->MarginBottom),
-                                 textColor);
-                    ++i;
+                    shadeColor = textColor;
+                    pShades = GetShadeTable(shadeColor);
+                }
+                int nRowY = rowIdx * (std::max(pFont->height, cFont->Height) + cFont->MarginBottom);
+                if (nEllipsisGlyph >= 0)
+                {
+                    glyphs.push_back(GlyphDrawCommand{nX + startX + posMove, nY + cfontShift + nRowY,
+                                                      cFont->GetStyledGlyph(nEllipsisGlyph, nStyle), pShades});
                 }
                 else
                 {
-                    DrawTextChar(pFont, cFont, pPcx, currentChar, 0, nX + startX + posMove,
-                                 nY + startY + rowIdx * (std::max(pFont->height, cFont->Height) + cFont->MarginBottom),
-                                 textColor);
+                    for (int nDot = 0; nDot < 3; ++nDot)
+                    {
+                        glyphs.push_back(GlyphDrawCommand{nX + startX + posMove, nY + startY + nRowY,
+                                                          &pAsciiGlyphs['.'], pShades});
+                        posMove += GetFontCharWidth<TEncoding>(pFont, cFont, '.');
+                    }
+                }
+            }
+
+            ++rowIdx;
+
+            if (startY + (rowIdx + 1) * pFont->height > startY + nHeight)
+            {
+                break;
+            }
+        }
+
+        RasterizeGlyphs(surface, glyphs);
+    }
+
+    /**
+     * @brief 绘制位图缓存
+     * @param surface 绘制目标
+     * @param bitmap 文字位图
+     * @param nX 绘制位置左上角X坐标
+     * @param nY 绘制位置左上角Y坐标
+     */
+    void __fastcall BlitTextBitmap(TextSurface& surface, const TextBitmap& bitmap, int nX, int nY)
+    {
+        for (const TextBitmapSpan& span : bitmap.spans)
+        {
+            int nRow = nY + span.nY;
+            if ((unsigned)nRow >= (unsigned)surface.nHeight)
+            {
+                continue;
+            }
+
+            int nBegin = max(nX + span.nX, 0);
+            int nEnd = min(nX + span.nX + span.nLength, surface.nWidth);
+            if (nBegin >= nEnd)
+            {
+                continue;
+            }
+
+            PUINT8 pRowBuffer = surface.pBuffer + nRow * surface.nPitch;
+            size_t nPixel = span.nPixelOffset / bitmap.nBytesPerPixel + (nBegin - nX - span.nX);
+            if (bitmap.alphas.empty())
+            {
+                memcpy(pRowBuffer + nBegin * bitmap.nBytesPerPixel,
+                       bitmap.pixels.data() + nPixel * bitmap.nBytesPerPixel, (nEnd - nBegin) * bitmap.nBytesPerPixel);
+                continue;
+            }
+
+            for (int nCol = nBegin; nCol < nEnd; ++nCol, ++nPixel)
+            {
+                DWORD color = bitmap.nBytesPerPixel == 4 ? ((const DWORD*)bitmap.pixels.data())[nPixel]
+                                                         : UnpackRgb565(((const WORD*)bitmap.pixels.data())[nPixel]);
+                uint8_t alpha = bitmap.alphas[nPixel];
+                alpha == 255 ? DrawPixcel(pRowBuffer, nCol, color) : BlendPixcel(pRowBuffer, nCol, color, alpha);
+            }
+        }
+    }
+
+    /**
+     * @brief 使用位图缓存绘制文字，未命中时离屏绘制后加入缓存
+     * @return 是否已绘制，文字超出离屏范围时返回false
+     */
+    template <typename TEncoding>
+    bool __fastcall DrawCachedText(TextSurface& surface, H3Font* pFont, LPCSTR pStr, int nX, int nY, int nWidth,
+                                   int nHeight, uint32_t nColorIdx, uint32_t nAlignFlags, int nStyle)
+    {
+        TextBitmapKeyView keyView{pFont, pStr, nWidth, nHeight, nColorIdx, nAlignFlags, nStyle, H3BitMode::Get()};
+        auto it = TextBitmapMap.find(keyView);
+        if (it != TextBitmapMap.end())
+        {
+            TextBitmapList.splice(TextBitmapList.begin(), TextBitmapList, it->second);
+            BlitTextBitmap(surface, *it->second, nX, nY);
+            return true;
+        }
+
+        // 离屏范围需容纳对齐偏移、阴影以及超出文本框的首行
+        ExtFont* cFont = GetMappedExtFont(pFont);
+        int nMarginX = cFont->Width + 8;
+        int nMarginY = max<int>(pFont->height, cFont->Height) + cFont->MarginBottom + 8;
+        int nBytesPerPixel = keyView.nBitMode == 4 ? 4 : 2;
+
+        static vector<UINT8> captureBuffer;
+        static vector<UINT8> captureMask;
+        TextSurface capture;
+        capture.nWidth = nWidth + nMarginX * 2;
+        capture.nHeight = nHeight + nMarginY * 2;
+        capture.nPitch = capture.nWidth * nBytesPerPixel;
+        capture.nOriginX = nX - nMarginX;
+        capture.nOriginY = nY - nMarginY;
+        captureBuffer.resize(capture.nPitch * capture.nHeight);
+        captureMask.assign(capture.nWidth * capture.nHeight, 0);
+        capture.pBuffer = captureBuffer.data();
+        capture.pMask = captureMask.data();
+
+        DrawTextToSurface<TEncoding>(capture, pFont, pStr, nX, nY, nWidth, nHeight, nColorIdx, nAlignFlags, nStyle);
+        if (capture.bOverflow)
+        {
+            return false;
+        }
+
+        TextBitmap bitmap;
+        bitmap.key = TextBitmapKey{pFont, pStr, nWidth, nHeight, nColorIdx, nAlignFlags, nStyle, keyView.nBitMode};
+        bitmap.nBytesPerPixel = nBytesPerPixel;
+        for (int nRow = 0; nRow < capture.nHeight; ++nRow)
+        {
+            PUINT8 pMaskRow = capture.pMask + nRow * capture.nWidth;
+            for (int nCol = 0; nCol < capture.nWidth;)
+            {
+                if (!pMaskRow[nCol])
+                {
+                    ++nCol;
+                    continue;
+                }
+
+                int nSpanEnd = nCol;
+                while (nSpanEnd < capture.nWidth && pMaskRow[nSpanEnd])
+                {
+                    ++nSpanEnd;
                 }
 
-                posMove += GetFontCharWidth(pFont, cFont, currentChar);
-            }
+                bitmap.spans.push_back(TextBitmapSpan{(int16_t)(nCol - nMarginX), (int16_t)(nRow - nMarginY),
+                                                      (uint16_t)(nSpanEnd - nCol), (uint32_t)bitmap.pixels.size()});
+                PUINT8 pPixels = capture.pBuffer + nRow * capture.nPitch + nCol * nBytesPerPixel;
+                bitmap.pixels.insert(bitmap.pixels.end(), pPixels, pPixels + (nSpanEnd - nCol) * nBytesPerPixel);
+                bitmap.alphas.insert(bitmap.alphas.end(), pMaskRow + nCol, pMaskRow + nSpanEnd);
+                nCol = nSpanEnd;
+            }
+        }
+        if (ranges::all_of(bitmap.alphas, [](UINT8 alpha) { return alpha == 255; }))
+        {
+            bitmap.alphas.clear();
+        }
+        bitmap.spans.shrink_to_fit();
+        bitmap.pixels.shrink_to_fit();
+        bitmap.alphas.shrink_to_fit();
+
+        BlitTextBitmap(surface, bitmap, nX, nY);
+
+        size_t nSize = bitmap.Size();
+        if (nSize > TextBitmapCacheBudget)
+        {
+            return true;
+        }
+
+        // 淘汰最久未使用的位图
+        while (TextBitmapCacheUsed + nSize > TextBitmapCacheBudget)
+        {
+            TextBitmapCacheUsed -= TextBitmapList.back().Size();
+            TextBitmapMap.erase(TextBitmapList.back().key);
+            TextBitmapList.pop_back();
+        }
+
+        TextBitmapList.push_front(std::move(bitmap));
+        TextBitmapMap.emplace(TextBitmapList.front().key, TextBitmapList.begin());
+        TextBitmapCacheUsed += nSize;
+        return true;
+    }
+
+    /**
+     * @brief 绘制文本框的文字与光标，原版在光标位置插入 '_' 后整体绘制，光标后的文字随光标左右移动
+     * 改为绘制不含光标的文字，光标按前缀宽度索引画在字符边界处，并记录文本起点供点击定位
+     * @param surface 绘制目标
+     * @param pFont ASCII字体
+     * @param pStr 文本字符串
+     * @param nX 绘制字符位置左上角X坐标
+     * @param nY 绘制字符位置左上角Y坐标
+     * @param nWidth 文本框宽度
+     * @param nHeight 文本框高度
+     * @param nColorIdx 颜色序号，参考eTextColor定义
+     * @param nAlignFlags 文本排版规则，参考eTextAlignment定义
+     * @param nStyle 字符样式序号
+     * @return 文字不是文本框文本在光标处插入 '_' 的形式或超过一行时返回false，由调用者按普通文字绘制
+     */
+    template <typename TEncoding>
+    bool __fastcall DrawEditText(TextSurface& surface, H3Font* pFont, LPCSTR pStr, int nX, int nY, int nWidth,
+                                 int nHeight, uint32_t nColorIdx, uint32_t nAlignFlags, int nStyle)
+    {
+        H3DlgEdit* pEdit = CurrentDlgEdit;
+        string_view text = pEdit->GetText();
+        string_view drawn = pStr;
+        size_t nCaret = pEdit->GetCaret();
+        if (nCaret > text.length() || drawn.length() != text.length() + 1 || drawn[nCaret] != '_' ||
+            drawn.substr(0, nCaret) != text.substr(0, nCaret) || drawn.substr(nCaret + 1) != text.substr(nCaret))
+        {
+            return false;
+        }
+
+        ExtFont* cFont = GetMappedExtFont(pFont);
+        CaretIndex& index = GetCaretIndex<TEncoding>(pEdit, pFont);
+        vector<TextLineStruct> lines;
+        if (SplitTextToLines<TEncoding>(pFont, cFont, index.text, nWidth, &lines, nullptr) > 1)
+        {
+            return false;
+        }
+
+        // 与 DrawTextToSurface 相同的水平对齐
+        int nLineWidth = lines.empty() ? 0 : lines[0].nWidth;
+        int nStartX = 0;
+        switch (nAlignFlags & 3)
+        {
+        case 1:
+            nStartX = (nWidth - nLineWidth) / 2;
+            break;
+        case 2:
+            nStartX = nWidth - nLineWidth;
+            break;
+        }
+        index.OriginX = nX + nStartX - pEdit->GetX();
+
+        DrawTextToSurface<TEncoding>(surface, pFont, index.text.c_str(), nX, nY, nWidth, nHeight, nColorIdx,
+                                     nAlignFlags, nStyle);
+
+        // 光标单独排版，不覆盖文本框的增量排版状态
+        H3DlgText* pDlgText = CurrentDlgText;
+        CurrentDlgText = nullptr;
+        DrawTextToSurface<TEncoding>(surface, pFont, "_", nX + nStartX + index.GetCaretX(nCaret), nY,
+                                     GetFontCharWidth<TEncoding>(pFont, cFont, '_'), nHeight, nColorIdx,
+                                     nAlignFlags & ~3, nStyle);
+        CurrentDlgText = pDlgText;
+        return true;
+    }
+
+    /**
+     * @brief 绘制文字 H3中文: 0x4077D4 0x532BC0
+     * @param pFont ASCII字体
+     * @param pStr 文本字符串
+     * @param pPcx 图像输出
+     * @param nX 绘制字符位置左上角X坐标
+     * @param nY 绘制字符位置左上角Y坐标
+     * @param nWidth 文本框宽度
+     * @param nHeight 文本框高度
+     * @param nColorIdx 颜色序号，参考eTextColor定义
+     * @param nAlignFlags 文本排版规则，参考eTextAlignment定义
+     * @param nFontStyle 字体风格，对应 H3CN.toml 中字体的 Styles 序号，未配置时使用字体的默认样式
+     * @return
+     */
+    template <typename TEncoding>
+    void __stdcall TextDraw(HiHook* h, H3Font* pFont, LPCSTR pStr, H3LoadedPcx16* pPcx, int nX, int nY, int nWidth,
+                            int nHeight, uint32_t nColorIdx, uint32_t nAlignFlags, int nFontStyle)
+    {
+        if (nWidth == 0)
+        {
+            return;
+        }
+
+        // 根据游戏的图像模式初始化图像渲染
+        if (H3BitMode::Get() == 4)
+        {
+            GetColor = GetColor32;
+            DrawPixcel = DrawPixcel32;
+            BlendPixcel = BlendPixcel32;
+            BlendRow = GammaBlending ? BlendRowGamma : BlendRow32;
+        }
+        else
+        {
+            GetColor = GetColor16;
+            DrawPixcel = DrawPixcel16;
+            BlendPixcel = BlendPixcel16;
+            BlendRow = GammaBlending ? BlendRowGamma : BlendRow16;
+        }
 
-            ++rowIdx;
+        ExtFont* cFont = GetMappedExtFont(pFont);
+        int nStyle = cFont->GetStyle(nFontStyle) ? nFontStyle : cFont->DefaultStyle;
 
-            if (startY + (rowIdx + 1) * pFont->height > startY + nHeight)
-            {
-                break;
-            }
+        TextSurface surface(pPcx);
+        if (CurrentDlgEdit && CurrentDlgText == CurrentDlgEdit &&
+            DrawEditText<TEncoding>(surface, pFont, pStr, nX, nY, nWidth, nHeight, nColorIdx, nAlignFlags, nStyle))
+        {
+            return;
+        }
+        if (TextBitmapCache &&
+            DrawCachedText<TEncoding>(surface, pFont, pStr, nX, nY, nWidth, nHeight, nColorIdx, nAlignFlags, nStyle))
+        {
+            return;
         }
+
+        DrawTextToSurface<TEncoding>(surface, pFont, pStr, nX, nY, nWidth, nHeight, nColorIdx, nAlignFlags, nStyle);
     }
 
     /**
@@ -453,6 +2165,7 @@ namespace H3FontExtension
      * @param nWidth 文本框宽度
      * @return
      */
+    template <typename TEncoding>
     int __stdcall GetLinesCountInText(HiHook* h, H3Font* pFont, LPCSTR pStr, int nWidth)
     {
         if (nWidth == 0)
@@ -462,7 +2175,7 @@ namespace H3FontExtension
 
         // 汉字字体
         ExtFont* cFont = GetMappedExtFont(pFont);
-        int lineCount = SplitTextToLines(pFont, cFont, pStr, nWidth, nullptr, nullptr);
+        int lineCount = SplitTextToLines<TEncoding>(pFont, cFont, pStr, nWidth, nullptr, nullptr);
         return lineCount;
     }
 
@@ -472,6 +2185,7 @@ namespace H3FontExtension
      * @param pStr 文本字符串
      * @return
      */
+    template <typename TEncoding>
     int __stdcall GetMaxLineWidth(HiHook* h, H3Font* pFont, PUINT8 pStr)
     {
         // 汉字字体
@@ -481,6 +2195,8 @@ namespace H3FontExtension
         while (*pStr == '\n')
             ++pStr;
 
+        // 文本长度只计算一次，图标标记在该范围内查找
+        string_view text((LPCSTR)pStr);
         bool ignoreWidth = false;
         int maxLineWidth = cFont->Width;
         int curLineWidth = 0;
@@ -503,6 +2219,17 @@ namespace H3FontExtension
             {
                 continue;
             }
+            if (IsPlainAscii(code))
+            {
+                // 连续的普通ASCII字符直接累加字宽
+                size_t nPlain = CountPlainAsciiRun(pStr, text.data() + text.length() - (LPCSTR)pStr);
+                for (size_t i = 0; i < nPlain; ++i)
+                {
+                    curLineWidth += GetFontCharWidth<TEncoding>(pFont, cFont, pStr[i]);
+                }
+                pStr += nPlain - 1;
+                continue;
+            }
             if (code == '{' && *(pStr + 1) == '~')
             {
                 ignoreWidth = true;
@@ -510,18 +2237,29 @@ namespace H3FontExtension
             }
             if (code == '{')
             {
+                size_t nIconLength = 0;
+                int nIcon = ParseIconMarkup(text, (LPCSTR)pStr - text.data(), nIconLength);
+                if (nIcon >= 0)
+                {
+                    curLineWidth += cFont->GetIconAdvance(nIcon);
+                    pStr += nIconLength - 1;
+                }
                 continue;
             }
 
-            curLineWidth += GetFontCharWidth(pFont, cFont, *pStr);
-            if (code > 160) // 汉字占用双字节
-            {
-                ++pStr;
-            }
+            curLineWidth += GetFontCharWidth<TEncoding>(pFont, cFont, *pStr);
+            // 汉字占用多字节，后续字节无效时只跳过首字节，不越过字符串结尾
+            pStr += GetValidCharLength<TEncoding>(pStr, SIZE_MAX) - 1;
         }
 
         maxLineWidth = max(curLineWidth, maxLineWidth);
 
+        // 需要自动换行时按均衡行宽确定文本框宽度，行数、拆分与绘制均按该宽度进行
+        if (BalancedLines && maxLineWidth > MaxLineWidth)
+        {
+            return GetBalancedLineWidth<TEncoding>(pFont, cFont, text.data(), max(MinLineWidth, 1), MaxLineWidth);
+        }
+
         return clamp(maxLineWidth, MinLineWidth, MaxLineWidth);
     }
 
@@ -531,6 +2269,7 @@ namespace H3FontExtension
      * @param pStr 文本字符串
      * @return
      */
+    template <typename TEncoding>
     int __stdcall GetMaxWordWidth(HiHook* h, H3Font* _this, PUINT8 pStr)
     {
         const char spliter[] = {'\n', ' ', '\0'};
@@ -542,6 +2281,8 @@ namespace H3FontExtension
         while (*pStr == '\n')
             ++pStr;
 
+        // 文本长度只计算一次，图标标记在该范围内查找
+        string_view text((LPCSTR)pStr);
         bool ignoreWidth = false;
         int maxLineWidth = cFont->Width;
         int curLineWidth = 0;
@@ -555,9 +2296,9 @@ namespace H3FontExtension
                 continue;
             }
 
-            if (code > 160) // 汉字占用双字节
+            if (IsLeadByte<TEncoding>(code)) // 汉字占用多字节，后续字节无效时只跳过首字节
             {
-                ++pStr;
+                pStr += GetValidCharLength<TEncoding>(pStr, SIZE_MAX) - 1;
                 maxLineWidth = max(curLineWidth, maxLineWidth);
                 curLineWidth = 0;
                 continue;
@@ -579,10 +2320,17 @@ namespace H3FontExtension
             }
             if (code == '{')
             {
+                size_t nIconLength = 0;
+                int nIcon = ParseIconMarkup(text, (LPCSTR)pStr - text.data(), nIconLength);
+                if (nIcon >= 0)
+                {
+                    curLineWidth += cFont->GetIconAdvance(nIcon);
+                    pStr += nIconLength - 1;
+                }
                 continue;
             }
 
-            curLineWidth += GetFontCharWidth(_this, cFont, *pStr);
+            curLineWidth += GetFontCharWidth<TEncoding>(_this, cFont, *pStr);
         }
 
         return max(curLineWidth, maxLineWidth);
@@ -596,6 +2344,7 @@ namespace H3FontExtension
      * @param stringVector 拆分后的文本行容器
      * @return
      */
+    template <typename TEncoding>
     void __stdcall SplitTextIntoLines(HiHook* h, H3Font* pFont, LPCSTR pStr, int nWidth,
                                       H3Vector<H3String>& stringVector)
     {
@@ -612,7 +2361,328 @@ namespace H3FontExtension
 
         // 汉字字体
         ExtFont* cFont = GetMappedExtFont(pFont);
-        SplitTextToLines(pFont, cFont, pStr, nWidth, nullptr, &stringVector);
+        SplitTextToLines<TEncoding>(pFont, cFont, pStr, nWidth, nullptr, &stringVector);
+    }
+
+    /**
+     * @brief 文本控件绘制 H3DlgText::vDrawToWindow，记录当前控件用于增量排版
+     * @param _this 文本控件
+     * @return
+     */
+    void __stdcall DlgTextDrawToWindow(HiHook* h, H3DlgText* _this)
+    {
+        H3DlgText* pPrevDlgText = CurrentDlgText;
+        CurrentDlgText = _this;
+        THISCALL_1(void, h->GetDefaultFunc(), _this);
+        CurrentDlgText = pPrevDlgText;
+    }
+
+    /**
+     * @brief 文本框绘制 H3DlgEdit::vDrawToWindow，记录正在绘制的文本框，由 TextDraw 按前缀宽度索引绘制光标
+     * @param _this 文本框
+     * @return
+     */
+    void __stdcall DlgEditDrawToWindow(HiHook* h, H3DlgEdit* _this)
+    {
+        H3DlgText* pPrevDlgText = CurrentDlgText;
+        H3DlgEdit* pPrevDlgEdit = CurrentDlgEdit;
+        CurrentDlgText = _this;
+        CurrentDlgEdit = _this;
+        THISCALL_1(void, h->GetDefaultFunc(), _this);
+        CurrentDlgText = pPrevDlgText;
+        CurrentDlgEdit = pPrevDlgEdit;
+    }
+
+    /**
+     * @brief 读取 H3DlgText 的保护成员
+     */
+    struct DlgTextMembers : H3DlgText
+    {
+        static H3Font* GetFont(const H3DlgText* pText)
+        {
+            return pText->*(&DlgTextMembers::font);
+        }
+
+        static eTextAlignment GetAlignment(const H3DlgText* pText)
+        {
+            return pText->*(&DlgTextMembers::alignment);
+        }
+    };
+
+    /**
+     * @brief 文本框按键 H3DlgEdit::vProcessKey，移动光标后对齐到字符边界，光标不停在双字节字符中间
+     * @param _this 文本框
+     * @param msg 消息
+     * @return
+     */
+    template <typename TEncoding>
+    int __stdcall DlgEditProcessKey(HiHook* h, H3DlgEdit* _this, H3Msg* msg)
+    {
+        UINT nPrevCaret = _this->GetCaret();
+        UINT nPrevLength = _this->GetString()->Length();
+        int result = THISCALL_2(int, h->GetDefaultFunc(), _this, msg);
+
+        // 输入法逐字节输入双字节字符，文本改变时不调整光标
+        UINT nCaret = _this->GetCaret();
+        if (nCaret == nPrevCaret || _this->GetString()->Length() != nPrevLength)
+        {
+            return result;
+        }
+
+        const CaretIndex& index = GetCaretIndex<TEncoding>(_this, DlgTextMembers::GetFont(_this));
+        if (_this->SetCaret(index.Snap(nCaret, nCaret > nPrevCaret)))
+        {
+            _this->Draw();
+            _this->Refresh();
+        }
+        return result;
+    }
+
+    /**
+     * @brief 文本框消息 H3DlgEdit::vProcessMsg，点击文本时将光标移到最近的字符边界
+     * @param _this 文本框
+     * @param msg 消息
+     * @return
+     */
+    template <typename TEncoding>
+    int __stdcall DlgEditProcessMsg(HiHook* h, H3DlgEdit* _this, H3Msg* msg)
+    {
+        int result = THISCALL_2(int, h->GetDefaultFunc(), _this, msg);
+        if (!msg->IsLeftDown())
+        {
+            return result;
+        }
+
+        int nX = msg->GetX() - _this->GetAbsoluteX();
+        int nY = msg->GetY() - _this->GetAbsoluteY();
+        if (nX < 0 || nX >= _this->GetWidth() || nY < 0 || nY >= _this->GetHeight())
+        {
+            return result;
+        }
+
+        // 文本起点取最近一次绘制的位置，含文字区域边距；尚未绘制时按文本控件的水平对齐方式估算
+        const CaretIndex& index = GetCaretIndex<TEncoding>(_this, DlgTextMembers::GetFont(_this));
+        if (index.OriginX != INT_MIN)
+        {
+            nX -= index.OriginX;
+        }
+        else
+        {
+            int nTextWidth = index.Advances.back();
+            switch (DlgTextMembers::GetAlignment(_this) & 3)
+            {
+            case 1:
+                nX -= (_this->GetWidth() - nTextWidth) / 2;
+                break;
+            case 2:
+                nX -= _this->GetWidth() - nTextWidth;
+                break;
+            }
+        }
+
+        if (_this->SetCaret(index.HitTest(nX)))
+        {
+            _this->Draw();
+            _this->Refresh();
+        }
+        return result;
+    }
+
+    /**
+     * @brief 读取字库文件
+     * @param fileName 文件名
+     * @return 字库文件内容
+     */
+    FontFile __fastcall ReadFontFile(const string& fileName)
+    {
+        std::ifstream file(fileName, std::ios::in | std::ios::binary);
+
+        if (file.good() == false)
+        {
+            MessageBoxW(h3::H3Hwnd::Get(), L"初始化字体失败", L"错误", 0);
+            return FontFile();
+        }
+
+        file.seekg(0, std::ios::end);
+        std::streampos fileSize = file.tellg();
+        PUINT8 pBuffer = new UINT8[fileSize];
+
+        file.seekg(0, std::ios::beg);
+        file.read((char*)pBuffer, fileSize);
+
+        return FontFile{pBuffer, (size_t)fileSize};
+    }
+
+    /**
+     * @brief 在工作线程中加载字库文件，相同文件只加载一次
+     * @param fileName 文件名
+     * @return 字库文件
+     */
+    shared_future<FontFile> __fastcall LoadFontBankAsync(const string& fileName)
+    {
+        string key = fileName;
+        ranges::transform(key, key.begin(), [](char c) { return (char)tolower((uint8_t)c); });
+        auto it = FontBankMap.find(key);
+        if (it != FontBankMap.end())
+        {
+            return it->second.Buffer;
+        }
+
+        FontBank& bank = FontBankMap[key];
+        auto promise = make_shared<std::promise<FontFile>>();
+        bank.Buffer = promise->get_future().share();
+
+        GetWorkerPool().Submit([fileName, promise, &bank] {
+            auto loadStart = chrono::steady_clock::now();
+            FontFile fontFile = ReadFontFile(fileName);
+            bank.LoadTime = chrono::duration<double, milli>(chrono::steady_clock::now() - loadStart).count();
+            promise->set_value(fontFile);
+        });
+
+        return bank.Buffer;
+    }
+
+    /**
+     * @brief 全部字库加载完成后输出实际耗时与顺序加载耗时的对比
+     * @param startTime 开始加载时间
+     */
+    void __fastcall ReportFontBankLoading(chrono::steady_clock::time_point startTime)
+    {
+        vector<const FontBank*> banks;
+        for (const auto& [name, bank] : FontBankMap)
+        {
+            banks.push_back(&bank);
+        }
+
+        GetWorkerPool().Submit([banks, startTime] {
+            double sequentialTime = 0;
+            for (const FontBank* bank : banks)
+            {
+                bank->Buffer.wait();
+                sequentialTime += bank->LoadTime;
+            }
+            double wallTime = chrono::duration<double, milli>(chrono::steady_clock::now() - startTime).count();
+
+            wchar_t report[128];
+            swprintf(report, size(report), L"H3CN: 字库加载 %zu 个，耗时 %.1fms，顺序加载 %.1fms，节省 %.1fms\n",
+                     banks.size(), wallTime, sequentialTime, sequentialTime - wallTime);
+            OutputDebugStringW(report);
+        });
+    }
+
+    /**
+     * @brief 读取字符使用频率统计，每行格式为 “字符编码 次数”
+     * @param fileName 文件名
+     */
+    void __fastcall LoadGlyphProfile(const string& fileName)
+    {
+        GlyphProfile.assign(CurrentEncoding.GetGlyphCount(), 0);
+        GlyphProfileSaveTime = chrono::steady_clock::now();
+
+        std::ifstream file(fileName);
+        string line;
+        while (getline(file, line))
+        {
+            unsigned nCode = 0;
+            uint32_t nCount = 0;
+            if (line.empty() || line[0] == '#' || sscanf(line.c_str(), "%x %u", &nCode, &nCount) != 2)
+            {
+                continue;
+            }
+
+            int nIndex = CurrentEncoding.GetGlyphIndex(nCode >> 8, nCode & 0xFF);
+            if ((unsigned)nIndex < GlyphProfile.size())
+            {
+                GlyphProfile[nIndex] += nCount;
+            }
+        }
+    }
+
+    void __fastcall SaveGlyphProfile(const string& fileName, const vector<uint32_t>& profile)
+    {
+        vector<int> indices;
+        for (int i = 0; i < (int)profile.size(); ++i)
+        {
+            if (profile[i])
+            {
+                indices.push_back(i);
+            }
+        }
+        ranges::stable_sort(indices, [&](int left, int right) { return profile[left] > profile[right]; });
+
+        std::ofstream file(fileName);
+        file << "# H3CN 字符使用频率统计：" << CurrentEncoding.Name << "编码 次数\n";
+        for (int nIndex : indices)
+        {
+            char line[32];
+            snprintf(line, sizeof(line), "%02X%02X %u\n", CurrentEncoding.GetLeadByte(nIndex),
+                     CurrentEncoding.GetTrailByte(nIndex), profile[nIndex]);
+            file << line;
+        }
+    }
+
+    /**
+     * @brief 注入文本引擎函数劫持
+     */
+    template <typename TEncoding>
+    void __fastcall InstallTextHooks()
+    {
+        _PI->WriteHiHook(0x4B51F0, SPLICE_, THISCALL_, TextDraw<TEncoding>);
+        _PI->WriteHiHook(0x4B5580, SPLICE_, THISCALL_, GetLinesCountInText<TEncoding>); // 计算文本的行数
+        _PI->WriteHiHook(0x4B56F0, SPLICE_, THISCALL_, GetMaxLineWidth<TEncoding>);     // 最长文本行长度
+        _PI->WriteHiHook(0x4B5770, SPLICE_, THISCALL_, GetMaxWordWidth<TEncoding>);     // 最长单词长度
+        _PI->WriteHiHook(0x4B57E0, SPLICE_, THISCALL_, GetMaxLineWidth<TEncoding>);     // 最长换行长度
+        _PI->WriteHiHook(0x4B58F0, SPLICE_, THISCALL_, SplitTextIntoLines<TEncoding>);
+
+        // 文本框光标，虚函数表 v3C 按键、v08 消息
+        _PI->WriteHiHook(*(PUINT)(0x642D50 + 0x3C), SPLICE_, THISCALL_, DlgEditProcessKey<TEncoding>);
+        UINT nDlgTextMsg = *(PUINT)(0x642DC0 + 0x08);
+        UINT nDlgEditMsg = *(PUINT)(0x642D50 + 0x08);
+        if (nDlgEditMsg != nDlgTextMsg)
+        {
+            _PI->WriteHiHook(nDlgEditMsg, SPLICE_, THISCALL_, DlgEditProcessMsg<TEncoding>);
+        }
+    }
+
+    /**
+     * @brief 选择文本编码
+     * @return 注入对应文本引擎实例的函数
+     */
+    template <typename TEncoding>
+    auto __fastcall SelectTextEncoding() -> void(__fastcall*)()
+    {
+        CurrentEncoding = TEncoding::Info;
+        return InstallTextHooks<TEncoding>;
+    }
+
+    /**
+     * @brief 按编码名称选择文本编码
+     * @param name 编码名称
+     * @return 注入对应文本引擎实例的函数
+     */
+    auto __fastcall SelectTextEncoding(const string& name) -> void(__fastcall*)()
+    {
+        if (name == Big5Encoding::Info.Name)
+        {
+            return SelectTextEncoding<Big5Encoding>();
+        }
+        if (name == ShiftJisEncoding::Info.Name)
+        {
+            return SelectTextEncoding<ShiftJisEncoding>();
+        }
+        if (name == Cp949Encoding::Info.Name)
+        {
+            return SelectTextEncoding<Cp949Encoding>();
+        }
+        if (name == Utf8Encoding::Info.Name)
+        {
+            return SelectTextEncoding<Utf8Encoding>();
+        }
+        if (name != GbkEncoding::Info.Name)
+        {
+            MessageBoxW(H3Hwnd::Get(), L"不支持的文本编码，使用GBK", L"错误", 0);
+        }
+        return SelectTextEncoding<GbkEncoding>();
     }
 
     /**
@@ -628,22 +2698,154 @@ namespace H3FontExtension
         _P = GetPatcher();
         _PI = _P->CreateInstance("HD.Plugin.H3FontExtension");
 
+        auto installTextHooks = InstallTextHooks<GbkEncoding>;
+
         // 加载配置
         try
         {
             auto config = toml::parse_file("H3CN.toml");
 
+            // 文本编码决定字库布局，需先于字库与频率统计确定
+            installTextHooks = SelectTextEncoding(config["General"]["Encoding"].value_or("GBK"));
+
+            // 换行规则
+            LineBreakRules = config["General"]["LineBreakRules"].value_or(true);
+            HangingPunctuation = config["General"]["HangingPunctuation"].value_or(false);
+            WordWrap = config["General"]["WordWrap"].value_or(true);
+            BuildBreakClasses();
+
+            // 文字混合
+            TextBlending = config["General"]["TextBlending"].value_or(true);
+            GammaBlending = config["General"]["GammaBlending"].value_or(false);
+            if (GammaBlending)
+            {
+                TextGamma = MakeGammaTable(2.2);
+            }
+
+            // 性能选项
+            IncrementalLayout = config["Performance"]["IncrementalLayout"].value_or(true);
+            TextBitmapCache = config["Performance"]["TextBitmapCache"].value_or(false);
+            TextBitmapCacheBudget = config["Performance"]["TextBitmapCacheSize"].value_or(4096) * 1024;
+            ParallelGlyphThreshold = config["Performance"]["ParallelGlyphThreshold"].value_or(256);
+            WorkerThreads = config["Performance"]["WorkerThreads"].value_or(0);
+            PrescaleMasterFonts = config["Performance"]["PrescaleMasterFonts"].value_or(false);
+            GlyphProfileFile = config["Performance"]["GlyphProfile"].value_or("");
+            if (!GlyphProfileFile.empty())
+            {
+                LoadGlyphProfile(GlyphProfileFile);
+            }
+
             toml::array fontArr = *config["Fonts"].as_array();
 
+            // 字库文件在工作线程中并行加载，绘制时才等待加载完成
+            auto loadStartTime = chrono::steady_clock::now();
             for (int i = 0; i < 9; ++i)
             {
                 const auto& font = fontArr[i].as_table();
-                g_ExtFontTable[i] =
-                    new ExtFont(font->get("Name")->value_or(""), font->get("ExtFont")->value_or(""),
+                // FallbackFont 可以是单个文件名或按查找顺序排列的文件名数组
+                // 数组元素也可以是 { File = 文件名, BitDepth = 位深 }，为回退字库单独指定位深
+                vector<string> fallbackFiles;
+                vector<int> fallbackBitDepths;
+                auto addFallback = [&](string fileName, int nBitDepth) {
+                    if (!fileName.empty())
+                    {
+                        fallbackFiles.push_back(std::move(fileName));
+                        fallbackBitDepths.push_back(nBitDepth);
+                    }
+                };
+                if (const toml::array* files = (*font)["FallbackFont"].as_array())
+                {
+                    for (const auto& file : *files)
+                    {
+                        if (const toml::table* pFile = file.as_table())
+                        {
+                            addFallback(string((*pFile)["File"].value_or("")), (*pFile)["BitDepth"].value_or(0));
+                        }
+                        else
+                        {
+                            addFallback(string(file.value_or("")), 0);
+                        }
+                    }
+                }
+                else
+                {
+                    addFallback(string((*font)["FallbackFont"].value_or("")), 0);
+                }
+
+                // MasterFont 为母版字库，按 Width、Height 缩放生成字符，取代 ExtFont
+                string fontFile = string((*font)["MasterFont"].value_or(""));
+                int nMasterWidth = 0;
+                int nMasterHeight = 0;
+                if (!fontFile.empty())
+                {
+                    nMasterWidth = (*font)["MasterWidth"].value_or(0);
+                    nMasterHeight = (*font)["MasterHeight"].value_or(0);
+                    // 母版字库尺寸无法从HZK字库推断，缺少时报错并改用 ExtFont
+                    if (nMasterWidth <= 0 || nMasterHeight <= 0)
+                    {
+                        MessageBoxW(H3Hwnd::Get(), L"母版字库缺少 MasterWidth 或 MasterHeight", L"错误", 0);
+                        fontFile.clear();
+                        nMasterWidth = 0;
+                        nMasterHeight = 0;
+                    }
+                }
+                if (fontFile.empty())
+                {
+                    fontFile = font->get("ExtFont")->value_or("");
+                }
+
+                ExtFont* pExtFont = g_ExtFontTable[i] =
+                    new ExtFont(font->get("Name")->value_or(""), LoadFontBankAsync(fontFile),
                                 font->get("Height")->value_or(0), font->get("Width")->value_or(0),
                                 font->get("MarginLeft")->value_or(0), font->get("MarginRight")->value_or(0),
-                                font->get("MarginBottom")->value_or(2), font->get("DrawShadow")->value_or(true));
+                                font->get("MarginBottom")->value_or(2), font->get("DrawShadow")->value_or(true),
+                                (*font)["BitDepth"].value_or(8), fallbackFiles, nMasterWidth, nMasterHeight,
+                                fallbackBitDepths);
+
+                // Styles 为字符样式数组，样式序号从1开始，0表示无样式
+                if (const toml::array* styles = (*font)["Styles"].as_array())
+                {
+                    for (const auto& style : *styles)
+                    {
+                        const toml::table* pStyle = style.as_table();
+                        if (!pStyle)
+                        {
+                            continue;
+                        }
+                        pExtFont->Styles.push_back(GlyphStyle{(*pStyle)["Bold"].value_or(0),
+                                                              (*pStyle)["Oblique"].value_or(0.0f),
+                                                              (*pStyle)["Outline"].value_or(0),
+                                                              (*pStyle)["OutlineColor"].value_or(0u)});
+                    }
+                }
+                pExtFont->DefaultStyle = (*font)["Style"].value_or(0);
+                pExtFont->HighlightStyle = (*font)["HighlightStyle"].value_or(0);
+                if (!pExtFont->GetStyle(pExtFont->DefaultStyle))
+                {
+                    pExtFont->DefaultStyle = 0;
+                }
+                if (!pExtFont->GetStyle(pExtFont->HighlightStyle))
+                {
+                    pExtFont->HighlightStyle = 0;
+                }
+
+                // 相同母版字库与尺寸的字体共用预先缩放的字符
+                if (PrescaleMasterFonts && pExtFont->IsScaled())
+                {
+                    string key = fontFile + " " + to_string(pExtFont->Width) + "x" + to_string(pExtFont->Height);
+                    auto it = ScaledBankMap.find(key);
+                    if (it == ScaledBankMap.end())
+                    {
+                        pExtFont->PrescaleGlyphs();
+                        ScaledBankMap[key] = pExtFont->ScaledGlyphs;
+                    }
+                    else
+                    {
+                        pExtFont->ScaledGlyphs = it->second;
+                    }
+                }
             }
+            ReportFontBankLoading(loadStartTime);
 
             Cmpt_TextColor = config["General"]["TextColor"].value_or(true);
             if (Cmpt_TextColor)
@@ -652,6 +2854,24 @@ namespace H3FontExtension
                 TextColorMap = *configColor["TextColor"].as_table();
             }
 
+            // 行内图标 {@名称}，首次使用时读取游戏资源
+            if (const toml::table* icons = config["Icons"].as_table())
+            {
+                for (const auto& [name, value] : *icons)
+                {
+                    const toml::table* pIcon = value.as_table();
+                    if (!pIcon)
+                    {
+                        continue;
+                    }
+                    InlineIconNames[string(name.str())] = (int)InlineIcons.size();
+                    InlineIcons.push_back(InlineIcon{string((*pIcon)["Def"].value_or("")),
+                                                     (*pIcon)["Group"].value_or(0), (*pIcon)["Frame"].value_or(0),
+                                                     string((*pIcon)["Pcx"].value_or("")),
+                                                     (*pIcon)["Height"].value_or(0)});
+                }
+            }
+
             // 文本行宽计算规则限制
             MinLineWidth = config["MessageBox"]["MinLineWidth"].value_or(256);
             MaxLineWidth = config["MessageBox"]["MaxLineWidth"].value_or(-1);
@@ -659,6 +2879,7 @@ namespace H3FontExtension
             {
                 MaxLineWidth = H3GameWidth::Get() / 2 - 32 * 2;
             }
+            BalancedLines = config["MessageBox"]["BalancedLines"].value_or(false);
         }
         catch (const std::exception&)
         {
@@ -666,12 +2887,16 @@ namespace H3FontExtension
         }
 
         // 注入函数劫持
-        _PI->WriteHiHook(0x4B51F0, SPLICE_, THISCALL_, TextDraw);
-        _PI->WriteHiHook(0x4B5580, SPLICE_, THISCALL_, GetLinesCountInText); // 计算文本的行数
-        _PI->WriteHiHook(0x4B56F0, SPLICE_, THISCALL_, GetMaxLineWidth);     // 最长文本行长度
-        _PI->WriteHiHook(0x4B5770, SPLICE_, THISCALL_, GetMaxWordWidth);     // 最长单词长度
-        _PI->WriteHiHook(0x4B57E0, SPLICE_, THISCALL_, GetMaxLineWidth);     // 最长换行长度
-        _PI->WriteHiHook(0x4B58F0, SPLICE_, THISCALL_, SplitTextIntoLines);
+        installTextHooks();
+
+        // 文本控件绘制，虚函数表 v10，文本框另行记录以按前缀宽度索引绘制光标
+        UINT nDlgTextDraw = *(PUINT)(0x642DC0 + 0x10);
+        UINT nDlgEditDraw = *(PUINT)(0x642D50 + 0x10);
+        _PI->WriteHiHook(nDlgTextDraw, SPLICE_, THISCALL_, DlgTextDrawToWindow);
+        if (nDlgEditDraw != nDlgTextDraw)
+        {
+            _PI->WriteHiHook(nDlgEditDraw, SPLICE_, THISCALL_, DlgEditDrawToWindow);
+        }
 
         return true;
     }
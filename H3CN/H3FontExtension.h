@@ -1,7 +1,14 @@
 #pragma once
 
+#include <array>
+#include <climits>
+#include <deque>
+#include <future>
+#include <list>
 #include <map>
 #include <ranges>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #define _H3API_PATCHER_X86_
@@ -9,6 +16,13 @@
 #include <H3API.hpp>
 #include <toml.hpp>
 
+#include "H3Glyph.h"
+#include "H3GlyphBank.h"
+#include "H3GlyphBands.h"
+#include "H3LineBalance.h"
+#include "H3TextEncoding.h"
+#include "H3WorkerPool.h"
+
 static Patcher* _P;
 static PatcherInstance* _PI;
 
@@ -21,90 +35,705 @@ namespace H3FontExtension
 
     static int MinLineWidth = 400;
     static int MaxLineWidth = 400;
+    // 消息框按均衡行宽换行，各行长度接近
+    static bool BalancedLines = false;
+
+    // 避头尾换行规则，标点不位于行首、开括号不位于行尾
+    static bool LineBreakRules = true;
+    // 行尾的逗号、句号悬挂于行宽之外，不移到下一行
+    static bool HangingPunctuation = false;
+    // 按单词换行，拉丁字母与数字组成的单词不在中间拆分
+    static bool WordWrap = true;
+
+    /**
+     * @brief 字符换行类别，按位组合
+     */
+    enum BreakClass : uint8_t
+    {
+        // 避头：不能位于行首
+        BreakNoStart = 0x01,
+        // 避尾：不能位于行尾
+        BreakNoEnd = 0x02,
+        // 可悬挂于行尾
+        BreakHanging = 0x04,
+        // 单词字符：相邻的单词字符之间不能换行
+        BreakWord = 0x08,
+        // 空格：行尾空格悬挂于行宽之外，不计入行宽
+        BreakSpace = 0x10,
+    };
+
+    // 双字节字符的换行类别，按字符序号索引
+    static std::vector<uint8_t> GlyphBreakClasses;
+    // 单字节字符的换行类别
+    static std::array<uint8_t, 256> AsciiBreakClasses;
+
+    /**
+     * @brief 按当前文本编码与换行选项生成换行类别表，拆分行时按字符序号直接查表
+     */
+    void __fastcall BuildBreakClasses();
+
+    // 增量排版，仅对H3DlgText生效
+    static bool IncrementalLayout = true;
+    // 增量排版状态缓存上限，超出后整体清空
+    const size_t MaxTextLayoutStates = 256;
+
+    // 文本排版规则扩展，与 eTextAlignment 组合：只在换行符处换行，超出文本框宽度的行截断并以省略号结尾
+    const uint32_t TextAlignEllipsis = 0x10;
 
     struct TextLineStruct
     {
         std::string_view pText;
         int nStrLength;
         int nWidth;
+        // 行尾绘制省略号，nWidth 包含省略号宽度
+        bool bEllipsis = false;
+    };
+
+    /**
+     * @brief 文本控件排版状态，用于追加文本时从稳定行继续拆分
+     */
+    struct TextLayoutState
+    {
+        h3::H3Font* pFont = nullptr;
+        int nWidth = 0;
+        std::string text;
+        std::vector<TextLineStruct> textLines;
+    };
+
+    // 正在绘制的文本控件
+    static h3::H3DlgText* CurrentDlgText = nullptr;
+    // 正在绘制的文本框
+    static h3::H3DlgEdit* CurrentDlgEdit = nullptr;
+
+    static std::unordered_map<h3::H3DlgText*, TextLayoutState> TextLayoutMap;
+
+    /**
+     * @brief 文本框的字符前缀宽度索引，光标移动与点击定位复用，文本或字体改变时重建
+     */
+    struct CaretIndex
+    {
+        h3::H3Font* pFont = nullptr;
+        std::string text;
+        // 每个字节所在字符的起始位置，双字节字符、颜色标记与行内图标整体为一个字符，末尾为文本长度
+        std::vector<int> Starts;
+        // 每个字节所在字符之前的累计宽度，末尾为文本总宽度
+        std::vector<int> Advances;
+        // 字符起始位置，升序，末尾为文本长度
+        std::vector<int> Boundaries;
+        // 最近一次绘制时文本起点相对文本框左边界的坐标，含文字区域边距与水平对齐，未绘制时为 INT_MIN
+        int OriginX = INT_MIN;
+
+        /**
+         * @brief 光标位置对应的水平坐标
+         * @param nOffset 字节位置
+         * @return 相对文本起点的坐标
+         */
+        int GetCaretX(size_t nOffset) const
+        {
+            return Advances[nOffset < text.length() ? nOffset : text.length()];
+        }
+
+        /**
+         * @brief 对齐到字符边界
+         * @param nOffset 字节位置
+         * @param bForward 位于字符中间时向后对齐，否则向前对齐
+         * @return 字符边界
+         */
+        int Snap(size_t nOffset, bool bForward) const;
+
+        /**
+         * @brief 查找距离坐标最近的字符边界
+         * @param nX 相对文本起点的坐标
+         * @return 字节位置
+         */
+        int HitTest(int nX) const;
+    };
+
+    static std::unordered_map<h3::H3DlgEdit*, CaretIndex> CaretIndexMap;
+
+    /**
+     * @brief 文字绘制目标，可以是游戏图像或离屏缓冲区
+     */
+    struct TextSurface
+    {
+        PUINT8 pBuffer = nullptr;
+        int nPitch = 0;
+        int nWidth = 0;
+        int nHeight = 0;
+        // 缓冲区左上角对应的绘制坐标
+        int nOriginX = 0;
+        int nOriginY = 0;
+        // 离屏绘制时记录写入像素的覆盖度，0表示未写入
+        PUINT8 pMask = nullptr;
+        // 离屏绘制时存在缓冲区以外的像素
+        bool bOverflow = false;
+
+        TextSurface()
+        {
+        }
+
+        TextSurface(h3::H3LoadedPcx16* pPcx)
+            : pBuffer(pPcx->buffer)
+            , nPitch(pPcx->scanlineSize)
+            , nWidth(pPcx->width)
+            , nHeight(pPcx->height)
+        {
+        }
+    };
+
+    // 汉字边缘按覆盖度与背景混合，关闭时按覆盖度加深文字颜色后覆盖背景
+    static bool TextBlending = true;
+    // 在线性亮度空间混合
+    static bool GammaBlending = false;
+    static GammaTable TextGamma;
+
+    // 整串文字位图缓存，缓存静态标签的最终绘制结果
+    static bool TextBitmapCache = false;
+    static size_t TextBitmapCacheBudget = 4 * 1024 * 1024;
+
+    /**
+     * @brief 文字位图缓存键，文本使用string_view查询以避免拷贝
+     */
+    template <typename TString>
+    struct TextBitmapKeyT
+    {
+        h3::H3Font* pFont;
+        TString text;
+        int nWidth;
+        int nHeight;
+        uint32_t nColorIdx;
+        uint32_t nAlignFlags;
+        int nStyle;
+        int nBitMode;
+
+        template <typename TOther>
+        bool operator==(const TextBitmapKeyT<TOther>& other) const
+        {
+            return pFont == other.pFont && std::string_view(text) == std::string_view(other.text) &&
+                   nWidth == other.nWidth && nHeight == other.nHeight && nColorIdx == other.nColorIdx &&
+                   nAlignFlags == other.nAlignFlags && nStyle == other.nStyle && nBitMode == other.nBitMode;
+        }
+    };
+
+    typedef TextBitmapKeyT<std::string> TextBitmapKey;
+    typedef TextBitmapKeyT<std::string_view> TextBitmapKeyView;
+
+    struct TextBitmapKeyHash
+    {
+        using is_transparent = void;
+
+        template <typename TString>
+        size_t operator()(const TextBitmapKeyT<TString>& key) const
+        {
+            size_t hash = std::hash<std::string_view>()(key.text);
+            for (size_t value : {(size_t)key.pFont, (size_t)key.nWidth, (size_t)key.nHeight, (size_t)key.nColorIdx,
+                                 (size_t)key.nAlignFlags, (size_t)key.nStyle, (size_t)key.nBitMode})
+            {
+                hash ^= value + 0x9E3779B9 + (hash << 6) + (hash >> 2);
+            }
+            return hash;
+        }
+    };
+
+    struct TextBitmapKeyEqual
+    {
+        using is_transparent = void;
+
+        template <typename TLeft, typename TRight>
+        bool operator()(const TextBitmapKeyT<TLeft>& left, const TextBitmapKeyT<TRight>& right) const
+        {
+            return left == right;
+        }
+    };
+
+    /**
+     * @brief 位图中一段连续的文字像素，坐标相对绘制位置
+     */
+    struct TextBitmapSpan
+    {
+        int16_t nX;
+        int16_t nY;
+        uint16_t nLength;
+        uint32_t nPixelOffset;
+    };
+
+    struct TextBitmap
+    {
+        TextBitmapKey key;
+        int nBytesPerPixel = 0;
+        std::vector<TextBitmapSpan> spans;
+        std::vector<UINT8> pixels;
+        // 每个像素的覆盖度，绘制时与背景混合，全部不透明时为空
+        std::vector<UINT8> alphas;
+
+        size_t Size() const
+        {
+            return sizeof(TextBitmap) + key.text.capacity() + spans.capacity() * sizeof(TextBitmapSpan) +
+                   pixels.capacity() + alphas.capacity();
+        }
+    };
+
+    // 最近使用的位图位于表头
+    static std::list<TextBitmap> TextBitmapList;
+    static std::unordered_map<TextBitmapKey, std::list<TextBitmap>::iterator, TextBitmapKeyHash, TextBitmapKeyEqual>
+        TextBitmapMap;
+    static size_t TextBitmapCacheUsed = 0;
+
+    struct ExtFont;
+
+    /**
+     * @brief 字符绘制命令
+     */
+    struct GlyphDrawCommand
+    {
+        int nX;
+        int nY;
+        // 字符画，在主线程中读取，绘制线程只读
+        const GlyphBitmap* pGlyph;
+        // 文字颜色的色阶表，参考 GetShadeTable
+        const DWORD* pShades;
+    };
+
+    // 文字颜色的色阶表，按颜色缓存，颜色来自字体调色板与颜色表，数量有限
+    static std::unordered_map<DWORD, std::array<DWORD, 256>> ShadeTables;
+
+    /**
+     * @brief 获取文字颜色的色阶表，覆盖度 -> 颜色，覆盖度255为文字颜色本身
+     * @param color RGB颜色码
+     * @return 色阶表，地址在整个生命周期内不变
+     */
+    const DWORD* __fastcall GetShadeTable(DWORD color);
+
+    /**
+     * @brief H3字体的英文字符，首次绘制时转换为统一格式
+     */
+    struct AsciiGlyphSet
+    {
+        // 转换时的H3字体字符画，字体重新加载后重新转换
+        PUINT8 pSource = nullptr;
+        std::array<GlyphBitmap, 256> Glyphs;
+        GlyphArena Arena;
+    };
+
+    // 按字体与样式缓存，样式为nullptr表示无样式
+    static std::map<std::pair<h3::H3Font*, const GlyphStyle*>, AsciiGlyphSet> AsciiGlyphMap;
+
+    /**
+     * @brief 获取H3字体的英文字符画，255转换为覆盖度，其他非0值转换为阴影
+     * @param pFont ASCII字体
+     * @param pStyle 字符样式，nullptr表示无样式
+     * @return 按字符代码索引的字符画
+     */
+    const GlyphBitmap* __fastcall GetAsciiGlyphs(h3::H3Font* pFont, const GlyphStyle* pStyle = nullptr);
+
+    /**
+     * @brief 行内图标，文本中的 {@名称} 按图标宽度排版，绘制为彩色字符
+     */
+    struct InlineIcon
+    {
+        // DEF 资源的组与帧，为空时使用 PCX 资源
+        std::string Def;
+        int Group = 0;
+        int Frame = 0;
+        std::string Pcx;
+        // 图标高度，0表示与汉字字高相同
+        int Height = 0;
+    };
+
+    /**
+     * @brief 图标图集，首次使用图标时一次性读取全部图标，按不透明范围裁剪后横向排列
+     */
+    struct IconAtlas
+    {
+        bool Loaded = false;
+        int Width = 0;
+        int Height = 0;
+        // 预乘不透明度的红、绿、蓝分量与不透明度，大小均为 Width * Height
+        std::array<std::vector<uint8_t>, 4> Planes;
+        // 各图标在图集中的范围 左、宽、高，读取失败的图标宽度为0
+        std::vector<std::array<int, 3>> Rects;
+    };
+
+    static std::vector<InlineIcon> InlineIcons;
+    // 图标名称 -> 图标序号
+    static std::map<std::string, int, std::less<>> InlineIconNames;
+    static IconAtlas InlineIconAtlas;
+
+    /**
+     * @brief 从游戏资源读取全部图标到图集，只在主线程中调用
+     */
+    void __fastcall LoadIconAtlas();
+
+    /**
+     * @brief 解析行内图标标记 {@名称}
+     * @param text 文本
+     * @param nPos 字符 '{' 的位置
+     * @param nLength 输出标记长度
+     * @return 图标序号，不是图标标记或图标未定义时返回-1，此时按普通文字处理
+     */
+    int __fastcall ParseIconMarkup(std::string_view text, size_t nPos, size_t& nLength);
+
+    // 单次绘制字符数量达到阈值时多线程绘制，0表示关闭
+    static size_t ParallelGlyphThreshold = 256;
+
+    /**
+     * @brief 字库文件内容
+     */
+    struct FontFile
+    {
+        PUINT8 Buffer = nullptr;
+        size_t Size = 0;
+    };
+
+    // 当前文本编码的字库布局
+    static TextEncodingInfo CurrentEncoding = GbkEncoding::Info;
+
+    /**
+     * @brief 字符对应的Unicode码位，用于按Unicode码位索引的字库
+     * @param nIndex 字符序号
+     * @return Unicode码位，无对应字符时返回-1
+     */
+    int __fastcall GetGlyphCodePoint(int nIndex);
+
+    /**
+     * @brief Unicode码位对应的GBK字符序号，用于UTF-8文本使用非Unicode字库
+     * @param nCodePoint Unicode码位
+     * @return GBK字符序号，无对应字符时返回-1
+     */
+    int __fastcall GetCodePointGlyph(int nCodePoint);
+
+    /**
+     * @brief 省略号“…”在当前文本编码中的字符序号
+     * @return 字符序号，编码中没有省略号时返回-1
+     */
+    int __fastcall GetEllipsisGlyph();
+
+    /**
+     * @brief 字库数据源，普通HZK字库或索引字库
+     */
+    struct GlyphSource
+    {
+        // 异步加载中的字库文件
+        std::shared_future<FontFile> FileFuture;
+        FontFile File;
+        // 索引字库，普通HZK字库时为空
+        GlyphBankView Bank;
+        // 字库位深 1、2、4、8，索引字库以文件头为准
+        int BitDepth = 8;
+        bool Loaded = false;
+        // 字符存在位图，按字符序号每字符1位，用于回退字库链
+        std::vector<uint64_t> Presence;
+        // 字库加载完成后在工作线程中生成的字符存在位图
+        std::shared_future<std::vector<uint64_t>> PresenceFuture;
+
+        /**
+         * @brief 等待字库文件加载完成并识别索引字库
+         * @param nWidth 字宽
+         * @param nHeight 字高
+         */
+        void __fastcall Wait(int nWidth, int nHeight);
+
+        /**
+         * @brief 在工作线程中等待字库加载并生成字符存在位图，普通HZK字库中全空白的字符视为不存在
+         * @param nWidth 字宽
+         * @param nHeight 字高
+         */
+        void __fastcall BuildPresenceAsync(int nWidth, int nHeight);
+
+        /**
+         * @brief 等待字库加载与字符存在位图生成完成
+         * @param nWidth 字宽
+         * @param nHeight 字高
+         */
+        void __fastcall WaitPresence(int nWidth, int nHeight);
+
+        /**
+         * @brief 字库中是否存在字符，需先等待字符存在位图
+         * @param nIndex 字符序号
+         */
+        inline bool Contains(int nIndex) const
+        {
+            return this->Presence[nIndex >> 6] >> (nIndex & 63) & 1;
+        }
+
+        /**
+         * @brief 查找字符
+         * @param nIndex 字符序号
+         * @param nWidth 字宽
+         * @param nHeight 字高
+         * @return 字符数据，不存在时返回nullptr
+         */
+        inline const uint8_t* __fastcall Find(int nIndex, int nWidth, int nHeight) const
+        {
+            // 字符序号与字库索引键不同时转换，UTF-8文本的非Unicode字库按GBK布局
+            if (CurrentEncoding.Unicode != (this->Bank.Header && this->Bank.IsUnicode()))
+            {
+                nIndex = CurrentEncoding.Unicode ? GetCodePointGlyph(nIndex) : GetGlyphCodePoint(nIndex);
+            }
+            if (this->Bank.Header)
+            {
+                return this->Bank.Find(nIndex);
+            }
+
+            size_t nGlyphSize = GetPackedGlyphSize(nWidth, nHeight, this->BitDepth);
+            if (!this->File.Buffer || nIndex < 0 || (nIndex + 1) * nGlyphSize > this->File.Size)
+            {
+                return nullptr;
+            }
+            return this->File.Buffer + nIndex * nGlyphSize;
+        }
     };
 
     struct ExtFont
     {
     public:
         std::string ASCIIFontName;
-        PUINT8 FontFileBuffer = nullptr;
+        GlyphSource Source;
+        // 回退字库链，主字库中不存在的字符按顺序查找，首次需要时才加载
+        std::vector<std::string> FallbackFileNames;
+        std::vector<GlyphSource> Fallbacks;
+        // 按字符序号缓存字符所在字库：0 未查找，1 主字库，2.. 回退字库，ResolvedMissing 均不存在
+        std::vector<uint8_t> ResolvedSources;
+        static constexpr uint8_t ResolvedMissing = 0xFF;
         UINT8 Height = 0;
         int Width = 0;
+        // 主字库与回退字库的字符尺寸，使用母版字库时与字符尺寸不同，读取后缩放
+        int SourceWidth = 0;
+        int SourceHeight = 0;
+        GlyphScaler Scaler;
+        // 预先缩放的主字库字符覆盖度，按字库存储顺序排列，未开启预先缩放时无效
+        std::shared_future<std::vector<uint8_t>> ScaledGlyphs;
         int MarginLeft = 0;
         int MarginRight = 0;
         int MarginBottom = 0;
         bool DrawShadow = true;
+        // 字符样式，样式序号从1开始，0表示无样式
+        std::vector<GlyphStyle> Styles;
+        // 默认样式与 {...} 高亮文字的样式序号
+        int DefaultStyle = 0;
+        int HighlightStyle = 0;
+        // 带样式的字符，按样式序号 - 1 与字符序号索引，末尾为无效字符
+        std::vector<std::vector<const GlyphBitmap*>> StyledGlyphCaches;
+        // 按字体尺寸缩放的行内图标，按图标序号索引
+        std::vector<const GlyphBitmap*> IconGlyphs;
+        // 转换为统一格式的字符，按字符序号索引
+        std::vector<const GlyphBitmap*> GlyphCache;
+        std::deque<GlyphBitmap> GlyphBitmaps;
+        GlyphArena GlyphCacheArena;
+        // 字库中不存在的字符，不绘制任何像素
+        GlyphBitmap BlankGlyph;
+        // 无效字符
+        const GlyphBitmap* ReplacementGlyph = nullptr;
+        // 距离场字库的采样参数，按字库文件头生成
+        const GlyphBankHeader* FieldHeader = nullptr;
+        DistanceFieldSampler FieldSampler;
+        DistanceFieldSampler::Ramp FieldRamp;
+        DistanceFieldSampler::Ramp ShadowRamp;
 
         ExtFont()
         {
         }
 
-        ExtFont(LPCSTR lpASCIIFontName, LPCSTR lpFileName, int nHeight, int nWidth, int nMarginLeft, int nMarginRight,
-                int nMarginBottom, bool bDrawShadow)
+        ExtFont(LPCSTR lpASCIIFontName, std::shared_future<FontFile> fontFile, int nHeight, int nWidth,
+                int nMarginLeft, int nMarginRight, int nMarginBottom, bool bDrawShadow, int nBitDepth = 8,
+                const std::vector<std::string>& fallbackFileNames = {}, int nSourceWidth = 0, int nSourceHeight = 0,
+                const std::vector<int>& fallbackBitDepths = {})
         {
-            LoadHzhFont(lpASCIIFontName, lpFileName, nHeight, nWidth, nMarginLeft, nMarginRight, nMarginBottom,
-                        bDrawShadow);
+            LoadHzhFont(lpASCIIFontName, fontFile, nHeight, nWidth, nMarginLeft, nMarginRight, nMarginBottom,
+                        bDrawShadow, nBitDepth, fallbackFileNames, nSourceWidth, nSourceHeight, fallbackBitDepths);
         }
 
-        /// <summary>
-        /// 汉字结构体 H3中文: 0x40CF18 0x5863B0
-        /// </summary>
-        /// <param name="lpFileName"></param>
-        /// <param name="nHeight"></param>
-        /// <param name="nWidth"></param>
-        /// <returns></returns>
-        bool __fastcall LoadHzhFont(LPCSTR lpASCIIFontName, LPCSTR lpFileName, int nHeight, int nWidth, int nMarginLeft,
-                                    int nMarginRight, int nMarginBottom, bool bDrawShadow)
+        /**
+         * @brief 汉字结构体 H3中文: 0x40CF18 0x5863B0
+         * @param lpASCIIFontName H3字体名称
+         * @param fontFile 异步加载的字库文件
+         * @param nHeight 点阵字体高
+         * @param nWidth 点阵字体宽
+         * @param nBitDepth 字库位深 1、2、4、8
+         * @param fallbackFileNames 回退字库文件名，按查找顺序排列
+         * @param nSourceWidth 母版字库字宽，0表示字库即为目标尺寸
+         * @param nSourceHeight 母版字库字高，0表示字库即为目标尺寸
+         * @param fallbackBitDepths 回退字库位深，与 fallbackFileNames 对应，缺省或0表示与主字库相同
+         * @return
+         */
+        bool __fastcall LoadHzhFont(LPCSTR lpASCIIFontName, std::shared_future<FontFile> fontFile, int nHeight,
+                                    int nWidth, int nMarginLeft, int nMarginRight, int nMarginBottom, bool bDrawShadow,
+                                    int nBitDepth = 8, const std::vector<std::string>& fallbackFileNames = {},
+                                    int nSourceWidth = 0, int nSourceHeight = 0,
+                                    const std::vector<int>& fallbackBitDepths = {})
         {
-            std::ifstream file(lpFileName, std::ios::in | std::ios::binary);
-
-            if (file.good() == false)
-            {
-                MessageBoxW(h3::H3Hwnd::Get(), L"初始化字体失败", L"错误", 0);
-                return false;
-            }
-
-            file.seekg(0, std::ios::end);
-            std::streampos fileSize = file.tellg();
-
             this->DrawShadow = bDrawShadow;
             this->MarginRight = nMarginRight;
             this->MarginLeft = nMarginLeft;
             this->MarginBottom = nMarginBottom;
             this->Width = nWidth;
             this->Height = nHeight;
+            this->SourceWidth = nSourceWidth > 0 ? nSourceWidth : nWidth;
+            this->SourceHeight = nSourceHeight > 0 ? nSourceHeight : nHeight;
+            if (this->SourceWidth != nWidth || this->SourceHeight != nHeight)
+            {
+                this->Scaler = GlyphScaler(this->SourceWidth, this->SourceHeight, nWidth, nHeight);
+            }
             this->ASCIIFontName = std::string(lpASCIIFontName);
-            this->FontFileBuffer = new UINT8[fileSize];
+            this->Source.FileFuture = fontFile;
+            this->Source.BitDepth = nBitDepth == 1 || nBitDepth == 2 || nBitDepth == 4 ? nBitDepth : 8;
+            this->FallbackFileNames = fallbackFileNames;
+            this->Fallbacks.resize(fallbackFileNames.size());
+            for (size_t i = 0; i < this->Fallbacks.size(); ++i)
+            {
+                int nFallbackDepth = i < fallbackBitDepths.size() ? fallbackBitDepths[i] : 0;
+                bool bValidDepth =
+                    nFallbackDepth == 1 || nFallbackDepth == 2 || nFallbackDepth == 4 || nFallbackDepth == 8;
+                this->Fallbacks[i].BitDepth = bValidDepth ? nFallbackDepth : this->Source.BitDepth;
+            }
+            // 存在回退字库时按字符存在位图查找，主字库加载完成后即在工作线程中生成
+            if (!this->Fallbacks.empty())
+            {
+                this->Source.BuildPresenceAsync(this->SourceWidth, this->SourceHeight);
+            }
 
-            file.seekg(0, std::ios::beg);
-            file.read((char*)this->FontFileBuffer, fileSize);
+            return true;
+        }
 
-            return false;
+        /**
+         * @brief 等待字库文件加载完成，仅在绘制前需要
+         */
+        inline void WaitFontFile()
+        {
+            this->Source.Wait(this->SourceWidth, this->SourceHeight);
         }
 
         /**
          * @brief 读取HZK字库字符画 H3中文: 0x4062B2 0x5325E0
-         * @param section 区码
-         * @param position 位码
-         * @return 汉字库字符指针
+         * @param nIndex 字符序号，参考 TextEncodingInfo::GetGlyphIndex
+         * @return 汉字库字符指针，使用母版字库时为缩放前的字符，不存在时返回nullptr
+         */
+        inline PUINT8 __fastcall GetHzkCharacterPcxPointer(int nIndex)
+        {
+            return (PUINT8)this->Source.Find(nIndex, this->SourceWidth, this->SourceHeight);
+        }
+
+        /**
+         * @brief 是否由母版字库缩放生成字符
+         */
+        inline bool IsScaled() const
+        {
+            return this->SourceWidth != this->Width || this->SourceHeight != this->Height;
+        }
+
+        /**
+         * @brief 在工作线程中预先缩放主字库的全部字符，完成前读取字符时逐个缩放
+         */
+        void __fastcall PrescaleGlyphs();
+
+        /**
+         * @brief 读取汉字字符画，首次读取时展开并转换为统一格式
+         * @param nIndex 字符序号，参考 TextEncodingInfo::GetGlyphIndex，小于0表示无效字符
+         * @return 字符画
+         */
+        const GlyphBitmap* __fastcall GetGlyph(int nIndex);
+
+        /**
+         * @brief 读取带样式的字符画，首次读取时生成
+         * @param nIndex 字符序号，小于0表示无效字符
+         * @param nStyle 样式序号，0或超出范围时无样式
+         * @return 字符画
+         */
+        const GlyphBitmap* __fastcall GetStyledGlyph(int nIndex, int nStyle);
+
+        /**
+         * @brief 读取行内图标，首次读取时从图集缩放到字体尺寸，垂直方向与汉字居中对齐
+         * @param nIcon 图标序号
+         * @return 字符画
+         */
+        const GlyphBitmap* __fastcall GetIconGlyph(int nIcon);
+
+        /**
+         * @brief 行内图标的字宽，与汉字相同包含左右边距
+         * @param nIcon 图标序号
          */
-        inline PUINT8 __fastcall GetHzkCharacterPcxPointer(UINT8 section, UINT8 position)
+        inline int __fastcall GetIconAdvance(int nIcon)
         {
-            // GB2312
-            // return this->FontFileBuffer + this->Width * ((this->Height + 7) >> 3) * (0x5E * (section - 0xA1) +
-            // position - 0xA1);
+            return this->MarginLeft + GetIconGlyph(nIcon)->Width + this->MarginRight;
+        }
 
-            // GBK
-            return this->FontFileBuffer + this->Width * this->Height * ((section - 0x81) * 0xBF + position - 0x40);
+        /**
+         * @brief 样式序号对应的样式
+         * @param nStyle 样式序号
+         * @return 样式，0或超出范围时返回nullptr
+         */
+        inline const GlyphStyle* GetStyle(int nStyle) const
+        {
+            return nStyle > 0 && nStyle <= (int)this->Styles.size() ? &this->Styles[nStyle - 1] : nullptr;
         }
+
+        /**
+         * @brief 查找字符所在字库，依次检查主字库与回退字库的字符存在位图
+         * @param nIndex 字符序号
+         * @return 字符所在字库，均不存在时返回nullptr
+         */
+        const GlyphSource* __fastcall ResolveSource(int nIndex);
+
+        /**
+         * @brief 无效字符的替换字符，空心方框
+         * @return 字符画
+         */
+        const GlyphBitmap* __fastcall GetReplacementGlyph();
+
+        /**
+         * @brief 将8位覆盖度转换为统一格式，需要时生成右下偏移1像素的阴影
+         * @param pCoverage 覆盖度，大小为 Width * Height
+         * @return 字符画
+         */
+        const GlyphBitmap* __fastcall MakeGlyphBitmap(const uint8_t* pCoverage);
+
+        /**
+         * @brief 按字体尺寸采样距离场字符，需要时生成右下偏移1像素的柔和阴影
+         * @param pHeader 距离场字库文件头
+         * @param pField 距离场
+         * @return 字符画
+         */
+        const GlyphBitmap* __fastcall MakeDistanceFieldGlyph(const GlyphBankHeader* pHeader, const uint8_t* pField);
+    };
+
+    /**
+     * @brief 字库文件，多个字体共用同一文件时只加载一次
+     */
+    struct FontBank
+    {
+        std::shared_future<FontFile> Buffer;
+        // 加载耗时（毫秒）
+        double LoadTime = 0;
     };
 
+    static std::map<std::string, FontBank> FontBankMap;
+
+    // 在工作线程中预先缩放母版字库
+    static bool PrescaleMasterFonts = false;
+    // 预先缩放的字符，按 “母版字库文件名 字宽x字高” 共享
+    static std::map<std::string, std::shared_future<std::vector<uint8_t>>> ScaledBankMap;
+
+    std::shared_future<FontFile> __fastcall LoadFontBankAsync(const std::string& fileName);
+
+    // 字符使用频率统计，按字符序号索引，用于生成热点字符重排字库
+    static std::string GlyphProfileFile;
+    static std::vector<uint32_t> GlyphProfile;
+    // 已统计的文本哈希，每段文本只统计一次，避免每帧重绘的静态文本主导排名
+    static std::unordered_set<size_t> ProfiledTexts;
+    // 已统计文本数量上限，超出后整体清空
+    const size_t MaxProfiledTexts = 4096;
+    // 统计有更新时定期在工作线程中保存
+    const std::chrono::seconds GlyphProfileSaveInterval(60);
+    static std::chrono::steady_clock::time_point GlyphProfileSaveTime;
+    static bool GlyphProfileDirty = false;
+
+    /**
+     * @brief 保存字符使用频率统计，按使用次数降序排列
+     * @param fileName 文件名
+     * @param profile 字符使用次数，按字符序号索引
+     */
+    void __fastcall SaveGlyphProfile(const std::string& fileName, const std::vector<uint32_t>& profile);
+
     // 汉字字体全局变量
     static ExtFont* g_ExtFontTable[9];
 
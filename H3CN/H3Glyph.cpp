@@ -0,0 +1,545 @@
+#include "H3Glyph.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define H3_GLYPH_SSE2
+#endif
+
+using namespace std;
+
+namespace H3FontExtension
+{
+    /**
+     * @brief 单字节展开表，每个字节对应 8 / nBitDepth 个覆盖度
+     */
+    template <int nBitDepth>
+    constexpr array<array<uint8_t, 8 / nBitDepth>, 256> MakeExpandTable()
+    {
+        constexpr int nPixels = 8 / nBitDepth;
+        constexpr int nMask = (1 << nBitDepth) - 1;
+        array<array<uint8_t, nPixels>, 256> table{};
+        for (int nByte = 0; nByte < 256; ++nByte)
+        {
+            for (int i = 0; i < nPixels; ++i)
+            {
+                int nValue = (nByte >> (8 - nBitDepth * (i + 1))) & nMask;
+                table[nByte][i] = (uint8_t)(nValue * 255 / nMask);
+            }
+        }
+        return table;
+    }
+
+    constexpr auto ExpandTable1 = MakeExpandTable<1>();
+    constexpr auto ExpandTable2 = MakeExpandTable<2>();
+    constexpr auto ExpandTable4 = MakeExpandTable<4>();
+
+    template <int nBitDepth>
+    inline void ExpandRow(const uint8_t* pPacked, uint8_t* pCoverage, int nWidth,
+                          const array<array<uint8_t, 8 / nBitDepth>, 256>& table)
+    {
+        constexpr int nPixels = 8 / nBitDepth;
+        int nColumn = 0;
+        for (; nColumn + nPixels <= nWidth; nColumn += nPixels)
+        {
+            memcpy(pCoverage + nColumn, table[*pPacked++].data(), nPixels);
+        }
+        if (nColumn < nWidth)
+        {
+            memcpy(pCoverage + nColumn, table[*pPacked].data(), nWidth - nColumn);
+        }
+    }
+
+#ifdef H3_GLYPH_SSE2
+    /**
+     * @brief 1位字符行展开，每次处理2字节16像素
+     */
+    inline void ExpandRow1Sse2(const uint8_t* pPacked, uint8_t* pCoverage, int nWidth)
+    {
+        const __m128i bitMask = _mm_setr_epi8((char)0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01, (char)0x80, 0x40,
+                                              0x20, 0x10, 0x08, 0x04, 0x02, 0x01);
+        int nColumn = 0;
+        for (; nColumn + 16 <= nWidth; nColumn += 16, pPacked += 2)
+        {
+            __m128i bytes = _mm_unpacklo_epi64(_mm_set1_epi8((char)pPacked[0]), _mm_set1_epi8((char)pPacked[1]));
+            __m128i bits = _mm_cmpeq_epi8(_mm_and_si128(bytes, bitMask), bitMask);
+            _mm_storeu_si128((__m128i*)(pCoverage + nColumn), bits);
+        }
+        ExpandRow<1>(pPacked, pCoverage + nColumn, nWidth - nColumn, ExpandTable1);
+    }
+#endif
+
+    void ExpandGlyph(const uint8_t* pPacked, uint8_t* pCoverage, int nWidth, int nHeight, int nBitDepth)
+    {
+        int nRowBytes = (nWidth * nBitDepth + 7) >> 3;
+        for (int nRow = 0; nRow < nHeight; ++nRow, pPacked += nRowBytes, pCoverage += nWidth)
+        {
+            switch (nBitDepth)
+            {
+            case 1:
+#ifdef H3_GLYPH_SSE2
+                ExpandRow1Sse2(pPacked, pCoverage, nWidth);
+#else
+                ExpandRow<1>(pPacked, pCoverage, nWidth, ExpandTable1);
+#endif
+                break;
+            case 2:
+                ExpandRow<2>(pPacked, pCoverage, nWidth, ExpandTable2);
+                break;
+            case 4:
+                ExpandRow<4>(pPacked, pCoverage, nWidth, ExpandTable4);
+                break;
+            default:
+                memcpy(pCoverage, pPacked, nWidth);
+                break;
+            }
+        }
+    }
+
+    GammaTable MakeGammaTable(double fGamma)
+    {
+        GammaTable table;
+        for (int i = 0; i < 256; ++i)
+        {
+            table.ToLinear[i] = (uint16_t)lround(pow(i / 255.0, fGamma) * 4095);
+        }
+        for (int i = 0; i < 4096; ++i)
+        {
+            table.FromLinear[i] = (uint8_t)lround(pow(i / 4095.0, 1 / fGamma) * 255);
+        }
+        return table;
+    }
+
+    /**
+     * @brief 两个8位分量按覆盖度插值，按四舍五入除以255
+     */
+    inline uint32_t LerpChannel(uint32_t nDest, uint32_t nColor, uint32_t nAlpha)
+    {
+        uint32_t nValue = nDest * (255 - nAlpha) + nColor * nAlpha + 128;
+        return (nValue + (nValue >> 8)) >> 8;
+    }
+
+    /**
+     * @brief 混合一个8位颜色分量
+     */
+    inline uint32_t BlendChannel(uint32_t nDest, uint32_t nColor, uint32_t nAlpha, const GammaTable* pGamma)
+    {
+        if (!pGamma)
+        {
+            return LerpChannel(nDest, nColor, nAlpha);
+        }
+        uint32_t nLinear = (pGamma->ToLinear[nDest] * (255 - nAlpha) + pGamma->ToLinear[nColor] * nAlpha + 127) / 255;
+        return pGamma->FromLinear[nLinear];
+    }
+
+    uint32_t BlendPixel888(uint32_t nDest, uint32_t nColor, uint8_t nAlpha, const GammaTable* pGamma)
+    {
+        if (nAlpha == 0 || nAlpha == 255)
+        {
+            return nAlpha ? nColor : nDest;
+        }
+
+        uint32_t nResult = LerpChannel(nDest >> 24, nColor >> 24, nAlpha) << 24;
+        for (int nShift = 0; nShift < 24; nShift += 8)
+        {
+            nResult |= BlendChannel((nDest >> nShift) & 0xFF, (nColor >> nShift) & 0xFF, nAlpha, pGamma) << nShift;
+        }
+        return nResult;
+    }
+
+    uint16_t BlendPixel565(uint16_t nDest, uint32_t nColor, uint8_t nAlpha, const GammaTable* pGamma)
+    {
+        return PackRgb565(BlendPixel888(UnpackRgb565(nDest), nColor, nAlpha, pGamma));
+    }
+
+#ifdef H3_GLYPH_SSE2
+    /**
+     * @brief 16位通道按覆盖度插值，与 LerpChannel 一致
+     */
+    inline __m128i LerpChannels(__m128i dest, __m128i color, __m128i alpha)
+    {
+        const __m128i full = _mm_set1_epi16(255);
+        const __m128i half = _mm_set1_epi16(128);
+        __m128i value = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(dest, _mm_sub_epi16(full, alpha)),
+                                                    _mm_mullo_epi16(color, alpha)),
+                                      half);
+        return _mm_srli_epi16(_mm_add_epi16(value, _mm_srli_epi16(value, 8)), 8);
+    }
+#endif
+
+    void BlendRow888(uint32_t* pRow, const uint8_t* pCoverage, int nCount, uint32_t nColor)
+    {
+        int i = 0;
+#ifdef H3_GLYPH_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i color = _mm_unpacklo_epi8(_mm_set1_epi32((int)nColor), zero);
+        for (; i + 4 <= nCount; i += 4)
+        {
+            uint32_t nAlphas;
+            memcpy(&nAlphas, pCoverage + i, 4);
+            if (!nAlphas)
+            {
+                continue;
+            }
+
+            // 每个像素的覆盖度扩展到4个通道
+            __m128i alpha = _mm_unpacklo_epi8(_mm_cvtsi32_si128((int)nAlphas), zero);
+            alpha = _mm_unpacklo_epi16(alpha, alpha);
+            __m128i alphaLow = _mm_unpacklo_epi32(alpha, alpha);
+            __m128i alphaHigh = _mm_unpackhi_epi32(alpha, alpha);
+
+            __m128i dest = _mm_loadu_si128((const __m128i*)(pRow + i));
+            __m128i low = LerpChannels(_mm_unpacklo_epi8(dest, zero), color, alphaLow);
+            __m128i high = LerpChannels(_mm_unpackhi_epi8(dest, zero), color, alphaHigh);
+            _mm_storeu_si128((__m128i*)(pRow + i), _mm_packus_epi16(low, high));
+        }
+#endif
+        for (; i < nCount; ++i)
+        {
+            if (pCoverage[i])
+            {
+                pRow[i] = BlendPixel888(pRow[i], nColor, pCoverage[i]);
+            }
+        }
+    }
+
+    void BlendRow565(uint16_t* pRow, const uint8_t* pCoverage, int nCount, uint32_t nColor)
+    {
+        int i = 0;
+#ifdef H3_GLYPH_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i red = _mm_set1_epi16((short)((nColor >> 16) & 0xFF));
+        const __m128i green = _mm_set1_epi16((short)((nColor >> 8) & 0xFF));
+        const __m128i blue = _mm_set1_epi16((short)(nColor & 0xFF));
+        const __m128i mask5 = _mm_set1_epi16(0x1F);
+        const __m128i mask6 = _mm_set1_epi16(0x3F);
+        for (; i + 8 <= nCount; i += 8)
+        {
+            __m128i alpha = _mm_loadl_epi64((const __m128i*)(pCoverage + i));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(alpha, zero)) == 0xFFFF)
+            {
+                continue;
+            }
+            alpha = _mm_unpacklo_epi8(alpha, zero);
+
+            // 展开为8位分量后混合，再打包为565
+            __m128i dest = _mm_loadu_si128((const __m128i*)(pRow + i));
+            __m128i destRed = _mm_srli_epi16(dest, 11);
+            __m128i destGreen = _mm_and_si128(_mm_srli_epi16(dest, 5), mask6);
+            __m128i destBlue = _mm_and_si128(dest, mask5);
+            destRed = _mm_or_si128(_mm_slli_epi16(destRed, 3), _mm_srli_epi16(destRed, 2));
+            destGreen = _mm_or_si128(_mm_slli_epi16(destGreen, 2), _mm_srli_epi16(destGreen, 4));
+            destBlue = _mm_or_si128(_mm_slli_epi16(destBlue, 3), _mm_srli_epi16(destBlue, 2));
+
+            __m128i resultRed = _mm_slli_epi16(_mm_srli_epi16(LerpChannels(destRed, red, alpha), 3), 11);
+            __m128i resultGreen = _mm_slli_epi16(_mm_srli_epi16(LerpChannels(destGreen, green, alpha), 2), 5);
+            __m128i resultBlue = _mm_srli_epi16(LerpChannels(destBlue, blue, alpha), 3);
+            _mm_storeu_si128((__m128i*)(pRow + i), _mm_or_si128(_mm_or_si128(resultRed, resultGreen), resultBlue));
+        }
+#endif
+        for (; i < nCount; ++i)
+        {
+            if (pCoverage[i])
+            {
+                pRow[i] = BlendPixel565(pRow[i], nColor, pCoverage[i]);
+            }
+        }
+    }
+
+    GlyphScaler::Axis GlyphScaler::MakeAxis(int nSource, int nTarget)
+    {
+        Axis axis;
+        axis.Offset.push_back(0);
+        for (int i = 0; i < nTarget; ++i)
+        {
+            // 以 1 / nTarget 源像素为单位，目标像素 i 覆盖 [i * nSource, (i + 1) * nSource)
+            int nStart = i * nSource;
+            int nEnd = nStart + nSource;
+            axis.First.push_back(nStart / nTarget);
+            int nCovered = 0;
+            int nPrevious = 0;
+            for (int j = nStart / nTarget; j * nTarget < nEnd; ++j)
+            {
+                // 按累计重叠面积取整，权重之和恰好为256
+                nCovered += min(nEnd, (j + 1) * nTarget) - max(nStart, j * nTarget);
+                int nWeight = (nCovered * 256 + nSource / 2) / nSource;
+                axis.Weights.push_back((uint16_t)(nWeight - nPrevious));
+                nPrevious = nWeight;
+            }
+            axis.Offset.push_back((int)axis.Weights.size());
+        }
+        return axis;
+    }
+
+    GlyphScaler::GlyphScaler(int nSourceWidth, int nSourceHeight, int nWidth, int nHeight)
+        : SourceWidth(nSourceWidth)
+        , Width(nWidth)
+        , Height(nHeight)
+        , Columns(MakeAxis(nSourceWidth, nWidth))
+        , Rows(MakeAxis(nSourceHeight, nHeight))
+    {
+    }
+
+    void GlyphScaler::Scale(const uint8_t* pSource, uint8_t* pCoverage) const
+    {
+        // 每个目标行先按行权重纵向合并为一行16位中间值（覆盖度 * 256），再按列权重横向合并
+        thread_local vector<uint16_t> sums;
+        sums.resize(SourceWidth);
+        for (int nRow = 0; nRow < Height; ++nRow, pCoverage += Width)
+        {
+            fill(sums.begin(), sums.end(), (uint16_t)0);
+            const uint8_t* pLine = pSource + Rows.First[nRow] * SourceWidth;
+            for (int k = Rows.Offset[nRow]; k < Rows.Offset[nRow + 1]; ++k, pLine += SourceWidth)
+            {
+                uint16_t nWeight = Rows.Weights[k];
+                int nColumn = 0;
+#ifdef H3_GLYPH_SSE2
+                // 权重之和不超过256，累加结果不超过 255 * 256，16位无符号不溢出
+                __m128i zero = _mm_setzero_si128();
+                __m128i weight = _mm_set1_epi16((short)nWeight);
+                for (; nColumn + 8 <= SourceWidth; nColumn += 8)
+                {
+                    __m128i pixels = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(pLine + nColumn)), zero);
+                    __m128i sum = _mm_loadu_si128((const __m128i*)(sums.data() + nColumn));
+                    _mm_storeu_si128((__m128i*)(sums.data() + nColumn),
+                                     _mm_add_epi16(sum, _mm_mullo_epi16(pixels, weight)));
+                }
+#endif
+                for (; nColumn < SourceWidth; ++nColumn)
+                {
+                    sums[nColumn] += (uint16_t)(pLine[nColumn] * nWeight);
+                }
+            }
+
+            for (int nColumn = 0; nColumn < Width; ++nColumn)
+            {
+                const uint16_t* pSums = sums.data() + Columns.First[nColumn];
+                uint32_t nSum = 0;
+                for (int k = Columns.Offset[nColumn]; k < Columns.Offset[nColumn + 1]; ++k)
+                {
+                    nSum += *pSums++ * (uint32_t)Columns.Weights[k];
+                }
+                pCoverage[nColumn] = (uint8_t)((nSum + 0x8000) >> 16);
+            }
+        }
+    }
+
+    DistanceFieldSampler::DistanceFieldSampler(int nFieldWidth, int nFieldHeight, int nPadding, int nSpread,
+                                               int nWidth, int nHeight)
+        : FieldWidth(nFieldWidth)
+        , FieldHeight(nFieldHeight)
+    {
+        // 目标像素 x 的中心对应距离场坐标 nPadding + (x + 0.5) * 字符框宽 / nWidth - 0.5
+        int nBoxWidth = nFieldWidth - nPadding * 2;
+        int nBoxHeight = nFieldHeight - nPadding * 2;
+        StepX = (int)(((int64_t)nBoxWidth << 16) / nWidth);
+        StepY = (int)(((int64_t)nBoxHeight << 16) / nHeight);
+        OriginX = (nPadding << 16) + StepX / 2 - 0x8000;
+        OriginY = (nPadding << 16) + StepY / 2 - 0x8000;
+        float fScale = ((float)nWidth / nBoxWidth + (float)nHeight / nBoxHeight) / 2;
+        LevelDistance = (float)nSpread / 127 * fScale;
+    }
+
+    DistanceFieldSampler::Ramp DistanceFieldSampler::MakeRamp(float fDilate, float fSoftness) const
+    {
+        Ramp ramp;
+        for (int i = 0; i < (int)ramp.size(); ++i)
+        {
+            // 128 为边缘，大于128在字符内
+            float fDistance = (i / 16.0f - 128) * LevelDistance + fDilate;
+            float fCoverage = min(max(0.5f + fDistance / fSoftness, 0.0f), 1.0f);
+            ramp[i] = (uint8_t)lround(fCoverage * 255);
+        }
+        return ramp;
+    }
+
+    void DistanceFieldSampler::Sample(const uint8_t* pField, const Ramp& ramp, uint8_t* pCoverage, int nOutWidth,
+                                      int nOutHeight, int nOffsetX, int nOffsetY) const
+    {
+        // 每列的左右采样位置与8位插值权重，超出距离场的坐标取边缘值
+        thread_local vector<int> columns;
+        thread_local vector<int> weights;
+        columns.resize(nOutWidth * 2);
+        weights.resize(nOutWidth);
+        auto locate = [](int nPosition, int nSize, int& nFirst, int& nSecond, int& nWeight) {
+            nFirst = nPosition >> 16;
+            nWeight = (nPosition >> 8) & 0xFF;
+            if (nFirst < 0)
+            {
+                nFirst = 0;
+                nWeight = 0;
+            }
+            else if (nFirst >= nSize - 1)
+            {
+                nFirst = nSize - 1;
+                nWeight = 0;
+            }
+            nSecond = min(nFirst + 1, nSize - 1);
+        };
+        for (int nColumn = 0; nColumn < nOutWidth; ++nColumn)
+        {
+            locate(OriginX + (nColumn + nOffsetX) * StepX, FieldWidth, columns[nColumn * 2], columns[nColumn * 2 + 1],
+                   weights[nColumn]);
+        }
+
+        for (int nRow = 0; nRow < nOutHeight; ++nRow, pCoverage += nOutWidth)
+        {
+            int nTop, nBottom, nWeightY;
+            locate(OriginY + (nRow + nOffsetY) * StepY, FieldHeight, nTop, nBottom, nWeightY);
+            const uint8_t* pTop = pField + nTop * FieldWidth;
+            const uint8_t* pBottom = pField + nBottom * FieldWidth;
+            for (int nColumn = 0; nColumn < nOutWidth; ++nColumn)
+            {
+                int nLeft = columns[nColumn * 2];
+                int nRight = columns[nColumn * 2 + 1];
+                int nWeightX = weights[nColumn];
+                int nUpper = pTop[nLeft] * (256 - nWeightX) + pTop[nRight] * nWeightX;
+                int nLower = pBottom[nLeft] * (256 - nWeightX) + pBottom[nRight] * nWeightX;
+                // 16位小数的采样值取4位小数查表
+                pCoverage[nColumn] = ramp[(nUpper * (256 - nWeightY) + nLower * nWeightY) >> 12];
+            }
+        }
+    }
+
+    uint8_t* GlyphArena::Allocate(size_t nSize)
+    {
+        if (nSize > ChunkSize)
+        {
+            Chunks.push_back(make_unique<uint8_t[]>(nSize));
+            return Chunks.back().get();
+        }
+
+        if (ChunkUsed + nSize > ChunkSize)
+        {
+            Chunks.push_back(make_unique<uint8_t[]>(ChunkSize));
+            CurrentChunk = Chunks.back().get();
+            ChunkUsed = 0;
+        }
+
+        uint8_t* pMemory = CurrentChunk + ChunkUsed;
+        ChunkUsed += nSize;
+        return pMemory;
+    }
+
+    GlyphBitmap ApplyGlyphStyle(const GlyphBitmap& glyph, const GlyphStyle& style, GlyphArena& arena)
+    {
+        int nBold = max(style.Bold, 0);
+        float fOblique = max(style.Oblique, 0.0f);
+        int nOutline = max(style.Outline, 0);
+        int nShadow = glyph.Shadow ? 1 : 0;
+
+        // 加粗：每个像素取自身与左侧 nBold 个像素的最大值
+        int nWidth = glyph.Width + nBold;
+        int nHeight = glyph.Height;
+        vector<uint8_t> shape(nWidth * nHeight);
+        for (int nRow = 0; nRow < nHeight; ++nRow)
+        {
+            const uint8_t* pSource = glyph.Coverage + nRow * glyph.Width;
+            for (int nColumn = 0; nColumn < nWidth; ++nColumn)
+            {
+                uint8_t nValue = 0;
+                for (int k = max(nColumn - glyph.Width + 1, 0); k <= nBold && k <= nColumn; ++k)
+                {
+                    nValue = max(nValue, pSource[nColumn - k]);
+                }
+                shape[nRow * nWidth + nColumn] = nValue;
+            }
+        }
+
+        // 倾斜：以底行为基准，每行右移 (nHeight - 1 - nRow) * fOblique 像素，小数部分线性插值
+        int nShear = (int)ceil((nHeight - 1) * fOblique);
+        if (nShear > 0)
+        {
+            int nShearWidth = nWidth + nShear;
+            vector<uint8_t> sheared(nShearWidth * nHeight);
+            for (int nRow = 0; nRow < nHeight; ++nRow)
+            {
+                float fShift = (nHeight - 1 - nRow) * fOblique;
+                int nShift = (int)fShift;
+                int nFraction = (int)((fShift - nShift) * 256);
+                const uint8_t* pSource = shape.data() + nRow * nWidth;
+                auto read = [&](int nColumn) { return nColumn >= 0 && nColumn < nWidth ? pSource[nColumn] : 0; };
+                for (int nColumn = 0; nColumn < nShearWidth; ++nColumn)
+                {
+                    int nValue = read(nColumn - nShift) * (256 - nFraction) + read(nColumn - nShift - 1) * nFraction;
+                    sheared[nRow * nShearWidth + nColumn] = (uint8_t)((nValue + 128) >> 8);
+                }
+            }
+            shape = std::move(sheared);
+            nWidth = nShearWidth;
+        }
+
+        // 字形四周扩展 nOutline 像素，阴影再向右下扩展1像素
+        int nOutWidth = nWidth + nOutline * 2 + nShadow;
+        int nOutHeight = nHeight + nOutline * 2 + nShadow;
+        size_t nSize = nOutWidth * nOutHeight;
+        int nPlanes = 1 + (nOutline ? 1 : 0) + nShadow;
+        uint8_t* pBuffer = arena.Allocate(nSize * nPlanes);
+        memset(pBuffer, 0, nSize * nPlanes);
+        uint8_t* pCoverage = pBuffer;
+        uint8_t* pOutline = nOutline ? pBuffer + nSize : nullptr;
+        uint8_t* pShadow = nShadow ? pBuffer + nSize * (nPlanes - 1) : nullptr;
+        for (int nRow = 0; nRow < nHeight; ++nRow)
+        {
+            memcpy(pCoverage + (nRow + nOutline) * nOutWidth + nOutline, shape.data() + nRow * nWidth, nWidth);
+        }
+
+        // 描边：半径 nOutline 圆内覆盖度的最大值，文字绘制在描边之上
+        if (pOutline)
+        {
+            vector<pair<int, int>> offsets;
+            for (int dy = -nOutline; dy <= nOutline; ++dy)
+            {
+                for (int dx = -nOutline; dx <= nOutline; ++dx)
+                {
+                    if (dx * dx + dy * dy <= nOutline * nOutline + nOutline)
+                    {
+                        offsets.emplace_back(dx, dy);
+                    }
+                }
+            }
+            for (int nRow = 0; nRow < nOutHeight; ++nRow)
+            {
+                for (int nColumn = 0; nColumn < nOutWidth; ++nColumn)
+                {
+                    uint8_t nValue = 0;
+                    for (auto [dx, dy] : offsets)
+                    {
+                        int x = nColumn + dx;
+                        int y = nRow + dy;
+                        if (x >= 0 && y >= 0 && x < nOutWidth && y < nOutHeight)
+                        {
+                            nValue = max(nValue, pCoverage[y * nOutWidth + x]);
+                        }
+                    }
+                    pOutline[nRow * nOutWidth + nColumn] = nValue;
+                }
+            }
+        }
+
+        // 阴影为描边后的字形向右下偏移1像素，不含完全被覆盖的像素
+        if (pShadow)
+        {
+            const uint8_t* pShape = pOutline ? pOutline : pCoverage;
+            for (int nRow = 1; nRow < nOutHeight; ++nRow)
+            {
+                for (int nColumn = 1; nColumn < nOutWidth; ++nColumn)
+                {
+                    size_t i = nRow * nOutWidth + nColumn;
+                    bool bCovered = pCoverage[i] == 255 || (pOutline && pOutline[i] == 255);
+                    pShadow[i] = bCovered ? 0 : pShape[i - nOutWidth - 1];
+                }
+            }
+        }
+
+        GlyphBitmap styled{pCoverage, pShadow, nOutWidth, nOutHeight, glyph.OffsetX - nOutline};
+        styled.Outline = pOutline;
+        styled.OutlineColor = style.OutlineColor;
+        styled.OffsetY = glyph.OffsetY - nOutline;
+        return styled;
+    }
+} // namespace H3FontExtension
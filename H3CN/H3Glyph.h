@@ -0,0 +1,261 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace H3FontExtension
+{
+    /**
+     * @brief 低位深字库单个字符的字节数，按行存储，每行按字节对齐
+     * @param nWidth 字宽
+     * @param nHeight 字高
+     * @param nBitDepth 位深 1、2、4、8
+     * @return 字节数
+     */
+    inline int GetPackedGlyphSize(int nWidth, int nHeight, int nBitDepth)
+    {
+        return ((nWidth * nBitDepth + 7) >> 3) * nHeight;
+    }
+
+    /**
+     * @brief 展开低位深字符为8位覆盖度，像素高位在前
+     * @param pPacked 低位深字符
+     * @param pCoverage 输出覆盖度，大小为 nWidth * nHeight
+     * @param nWidth 字宽
+     * @param nHeight 字高
+     * @param nBitDepth 位深 1、2、4、8
+     */
+    void ExpandGlyph(const uint8_t* pPacked, uint8_t* pCoverage, int nWidth, int nHeight, int nBitDepth);
+
+    /**
+     * @brief 伽马校正混合查找表，在线性亮度空间混合
+     */
+    struct GammaTable
+    {
+        // 8位颜色分量 -> 12位线性亮度
+        std::array<uint16_t, 256> ToLinear;
+        // 12位线性亮度 -> 8位颜色分量
+        std::array<uint8_t, 4096> FromLinear;
+    };
+
+    /**
+     * @brief 生成伽马校正混合查找表
+     * @param fGamma 伽马值，通常为2.2
+     * @return 查找表
+     */
+    GammaTable MakeGammaTable(double fGamma);
+
+    /**
+     * @brief RGB888颜色转换为RGB565
+     */
+    inline uint16_t PackRgb565(uint32_t nColor)
+    {
+        return (uint16_t)(((nColor >> 8) & 0xF800) | ((nColor >> 5) & 0x07E0) | ((nColor >> 3) & 0x001F));
+    }
+
+    /**
+     * @brief RGB565颜色转换为RGB888，5、6位分量按高位复制展开，重新打包后不变
+     */
+    inline uint32_t UnpackRgb565(uint16_t nColor)
+    {
+        uint32_t nRed = nColor >> 11, nGreen = (nColor >> 5) & 0x3F, nBlue = nColor & 0x1F;
+        return ((nRed << 3 | nRed >> 2) << 16) | ((nGreen << 2 | nGreen >> 4) << 8) | (nBlue << 3 | nBlue >> 2);
+    }
+
+    /**
+     * @brief 按覆盖度混合单个像素，覆盖度为0时不变，为255时为文字颜色
+     * @param nDest 背景像素
+     * @param nColor 文字颜色 RGB888
+     * @param nAlpha 覆盖度
+     * @param pGamma 伽马校正查找表，为nullptr时直接混合
+     * @return 混合结果
+     */
+    uint32_t BlendPixel888(uint32_t nDest, uint32_t nColor, uint8_t nAlpha, const GammaTable* pGamma = nullptr);
+    uint16_t BlendPixel565(uint16_t nDest, uint32_t nColor, uint8_t nAlpha, const GammaTable* pGamma = nullptr);
+
+    /**
+     * @brief 按覆盖度将文字颜色混合到一行像素，每次处理多个像素，结果与逐像素混合一致
+     * @param pRow 像素行
+     * @param pCoverage 覆盖度
+     * @param nCount 像素数量
+     * @param nColor 文字颜色 RGB888
+     */
+    void BlendRow888(uint32_t* pRow, const uint8_t* pCoverage, int nCount, uint32_t nColor);
+    void BlendRow565(uint16_t* pRow, const uint8_t* pCoverage, int nCount, uint32_t nColor);
+
+    /**
+     * @brief 字符缩放，按面积平均由母版字库生成任意尺寸的字符，目标像素为其覆盖的源像素按重叠面积加权平均
+     */
+    class GlyphScaler
+    {
+    public:
+        GlyphScaler()
+        {
+        }
+
+        /**
+         * @brief 预先计算行列权重
+         * @param nSourceWidth 源字宽
+         * @param nSourceHeight 源字高
+         * @param nWidth 目标字宽
+         * @param nHeight 目标字高
+         */
+        GlyphScaler(int nSourceWidth, int nSourceHeight, int nWidth, int nHeight);
+
+        /**
+         * @brief 缩放单个字符，可在多个线程中同时调用
+         * @param pSource 源覆盖度，大小为 nSourceWidth * nSourceHeight
+         * @param pCoverage 输出覆盖度，大小为 nWidth * nHeight
+         */
+        void Scale(const uint8_t* pSource, uint8_t* pCoverage) const;
+
+    private:
+        /**
+         * @brief 单个方向的权重，目标像素 i 使用源像素 First[i] 起的 Offset[i + 1] - Offset[i] 个权重，每个目标像素权重之和为256
+         */
+        struct Axis
+        {
+            std::vector<int> First;
+            std::vector<int> Offset;
+            std::vector<uint16_t> Weights;
+        };
+
+        static Axis MakeAxis(int nSource, int nTarget);
+
+        int SourceWidth = 0;
+        int Width = 0;
+        int Height = 0;
+        Axis Columns;
+        Axis Rows;
+    };
+
+    /**
+     * @brief 距离场字符采样，按任意尺寸生成覆盖度，扩张或柔化边缘可得到描边与柔和阴影
+     */
+    class DistanceFieldSampler
+    {
+    public:
+        // 双线性采样值（8位整数 + 4位小数）-> 覆盖度
+        typedef std::array<uint8_t, 4096> Ramp;
+
+        DistanceFieldSampler()
+        {
+        }
+
+        /**
+         * @brief 计算目标像素与距离场的坐标映射
+         * @param nFieldWidth 距离场宽度，含填充
+         * @param nFieldHeight 距离场高度，含填充
+         * @param nPadding 字符框四周的填充像素
+         * @param nSpread 127 级对应的距离（距离场像素）
+         * @param nWidth 目标字宽
+         * @param nHeight 目标字高
+         */
+        DistanceFieldSampler(int nFieldWidth, int nFieldHeight, int nPadding, int nSpread, int nWidth, int nHeight);
+
+        /**
+         * @brief 生成采样值到覆盖度的映射
+         * @param fDilate 边缘向外扩张的距离（目标像素），负数向内收缩
+         * @param fSoftness 边缘过渡宽度（目标像素），1为普通抗锯齿
+         * @return 映射表
+         */
+        Ramp MakeRamp(float fDilate, float fSoftness) const;
+
+        /**
+         * @brief 采样单个字符，可在多个线程中同时调用
+         * @param pField 距离场，大小为 nFieldWidth * nFieldHeight
+         * @param ramp 采样值到覆盖度的映射
+         * @param pCoverage 输出覆盖度，大小为 nOutWidth * nOutHeight
+         * @param nOutWidth 输出宽度
+         * @param nOutHeight 输出高度
+         * @param nOffsetX 输出左上角相对字符框的水平偏移，-1 表示字符向右下移动1像素
+         * @param nOffsetY 输出左上角相对字符框的垂直偏移
+         */
+        void Sample(const uint8_t* pField, const Ramp& ramp, uint8_t* pCoverage, int nOutWidth, int nOutHeight,
+                    int nOffsetX = 0, int nOffsetY = 0) const;
+
+    private:
+        int FieldWidth = 0;
+        int FieldHeight = 0;
+        // 目标像素中心对应的距离场坐标，16.16定点，OriginX 为第0列，每列增加 StepX
+        int OriginX = 0;
+        int OriginY = 0;
+        int StepX = 0;
+        int StepY = 0;
+        // 距离场相邻两级对应的目标像素距离
+        float LevelDistance = 0;
+    };
+
+    /**
+     * @brief 统一格式的字符画，英文字符与汉字共用，绘制时阴影在下、文字在上
+     */
+    struct GlyphBitmap
+    {
+        // 8位覆盖度，大小为 Width * Height
+        const uint8_t* Coverage = nullptr;
+        // 阴影覆盖度，不含完全被文字覆盖的像素，大小为 Width * Height，没有阴影时为nullptr
+        const uint8_t* Shadow = nullptr;
+        int Width = 0;
+        int Height = 0;
+        // 相对绘制位置的水平偏移
+        int OffsetX = 0;
+        // 描边覆盖度，绘制在阴影之上、文字之下，大小为 Width * Height，没有描边时为nullptr
+        const uint8_t* Outline = nullptr;
+        // 描边颜色 RGB888
+        uint32_t OutlineColor = 0;
+        // 相对绘制位置的垂直偏移，描边向上扩展时为负数
+        int OffsetY = 0;
+        // 逐像素颜色 RGB888，行内图标使用，大小为 Width * Height，为nullptr时使用文字颜色
+        const uint32_t* Colors = nullptr;
+    };
+
+    /**
+     * @brief 字符样式，依次加粗、倾斜、描边，最后按结果重新生成阴影；不改变字符间距
+     */
+    struct GlyphStyle
+    {
+        // 加粗像素，字符向右重叠复制
+        int Bold = 0;
+        // 倾斜，每向上一行右移的像素
+        float Oblique = 0;
+        // 描边像素
+        int Outline = 0;
+        // 描边颜色 RGB888
+        uint32_t OutlineColor = 0;
+
+        /**
+         * @brief 是否不改变字符，此时按无样式绘制
+         */
+        bool IsPlain() const
+        {
+            return Bold <= 0 && Oblique <= 0 && Outline <= 0;
+        }
+    };
+
+    /**
+     * @brief 字符缓存内存池，按块分配，分配出的内存在整个生命周期内地址不变
+     */
+    class GlyphArena
+    {
+    public:
+        uint8_t* Allocate(size_t nSize);
+
+    private:
+        static constexpr size_t ChunkSize = 64 * 1024;
+
+        std::vector<std::unique_ptr<uint8_t[]>> Chunks;
+        uint8_t* CurrentChunk = nullptr;
+        size_t ChunkUsed = ChunkSize;
+    };
+
+    /**
+     * @brief 生成带样式的字符，原字符有阴影时按描边后的字形重新生成右下偏移1像素的阴影
+     * @param glyph 原字符
+     * @param style 样式
+     * @param arena 字符画内存
+     * @return 字符画
+     */
+    GlyphBitmap ApplyGlyphStyle(const GlyphBitmap& glyph, const GlyphStyle& style, GlyphArena& arena);
+} // namespace H3FontExtension
@@ -0,0 +1,28 @@
+#include "H3GlyphBands.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace H3FontExtension
+{
+    bool DrawGlyphBands(WorkerPool& pool, int nTop, int nBottom, const function<void(int, int)>& drawBand)
+    {
+        int nBands = min<int>((int)(pool.Size() + 1) * 2, (nBottom - nTop) / MinGlyphBandHeight);
+        if (nBands < 2)
+        {
+            return false;
+        }
+
+        int nBandHeight = (nBottom - nTop + nBands - 1) / nBands;
+        pool.ParallelFor(nBands, [&](size_t nBand) {
+            int nBandTop = nTop + (int)nBand * nBandHeight;
+            int nBandBottom = min(nBandTop + nBandHeight, nBottom);
+            if (nBandTop < nBandBottom)
+            {
+                drawBand(nBandTop, nBandBottom);
+            }
+        });
+        return true;
+    }
+} // namespace H3FontExtension
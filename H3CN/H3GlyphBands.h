@@ -0,0 +1,70 @@
+#pragma once
+
+#include <functional>
+
+#include "H3WorkerPool.h"
+
+namespace H3FontExtension
+{
+    // 并行绘制的最小行带高度
+    const int MinGlyphBandHeight = 16;
+
+    /**
+     * @brief 字符画在绘制目标内的可见范围，行列相对字符画左上角，不含末尾
+     */
+    struct GlyphClip
+    {
+        int nFirstRow = 0;
+        int nLastRow = 0;
+        int nFirstColumn = 0;
+        int nLastColumn = 0;
+
+        bool IsEmpty() const
+        {
+            return nFirstRow >= nLastRow || nFirstColumn >= nLastColumn;
+        }
+    };
+
+    /**
+     * @brief 裁剪字符画到绘制目标
+     * @param nLeft 字符画左上角在绘制目标中的X坐标
+     * @param nTop 字符画左上角在绘制目标中的Y坐标
+     * @param nWidth 字符画宽
+     * @param nHeight 字符画高
+     * @param nSurfaceWidth 绘制目标宽
+     * @param nSurfaceHeight 绘制目标高
+     * @return 可见范围
+     */
+    inline GlyphClip ClipGlyph(int nLeft, int nTop, int nWidth, int nHeight, int nSurfaceWidth, int nSurfaceHeight)
+    {
+        GlyphClip clip;
+        clip.nFirstRow = nTop < 0 ? -nTop : 0;
+        clip.nLastRow = nTop + nHeight > nSurfaceHeight ? nSurfaceHeight - nTop : nHeight;
+        clip.nFirstColumn = nLeft < 0 ? -nLeft : 0;
+        clip.nLastColumn = nLeft + nWidth > nSurfaceWidth ? nSurfaceWidth - nLeft : nWidth;
+        return clip;
+    }
+
+    /**
+     * @brief 字符画是否与行带相交
+     * @param nTop 字符画上边界
+     * @param nHeight 字符画高
+     * @param nBandTop 行带上边界
+     * @param nBandBottom 行带下边界，不含
+     */
+    inline bool IntersectsGlyphBand(int nTop, int nHeight, int nBandTop, int nBandBottom)
+    {
+        return nTop < nBandBottom && nTop + nHeight > nBandTop;
+    }
+
+    /**
+     * @brief 把绘制范围划分为水平行带并行绘制，行带互不重叠，跨越行带的字符由各行带分别裁剪绘制
+     * 行带数量多于线程数量，先完成的线程继续领取剩余行带以平衡负载
+     * @param pool 线程池，调用线程同时参与绘制
+     * @param nTop 绘制范围上边界
+     * @param nBottom 绘制范围下边界，不含
+     * @param drawBand 绘制行带 drawBand(行带上边界, 行带下边界)
+     * @return 范围不足两个行带时不绘制并返回false，由调用者顺序绘制
+     */
+    bool DrawGlyphBands(WorkerPool& pool, int nTop, int nBottom, const std::function<void(int, int)>& drawBand);
+} // namespace H3FontExtension
@@ -0,0 +1,77 @@
+#include "H3GlyphBank.h"
+
+#include <cstring>
+
+namespace H3FontExtension
+{
+    bool GlyphBankView::Parse(const uint8_t* pBuffer, size_t nSize)
+    {
+        if (!pBuffer || nSize < sizeof(GlyphBankHeader) || memcmp(pBuffer, GlyphBankMagic, 4) != 0)
+        {
+            return false;
+        }
+
+        const GlyphBankHeader* pHeader = (const GlyphBankHeader*)pBuffer;
+        if (pHeader->Version != GlyphBankVersion || pHeader->GlyphCount > 0xFFFF)
+        {
+            return false;
+        }
+
+        // 字符框不能为空，位深只能为1、2、4、8
+        if (pHeader->Width == 0 || pHeader->Height == 0 ||
+            (pHeader->BitDepth != 1 && pHeader->BitDepth != 2 && pHeader->BitDepth != 4 && pHeader->BitDepth != 8))
+        {
+            return false;
+        }
+
+        // 距离场字库为8位，填充后仍需保留字符框
+        if ((pHeader->Flags & GlyphBankDistanceField) &&
+            (pHeader->BitDepth != 8 || pHeader->FieldSpread == 0 || pHeader->FieldPadding * 2 >= pHeader->Width ||
+             pHeader->FieldPadding * 2 >= pHeader->Height))
+        {
+            return false;
+        }
+
+        // 以64位计算范围，避免32位进程中字符数量与字符大小的乘积溢出
+        uint64_t nGlyphSize = (uint64_t)((pHeader->Width * pHeader->BitDepth + 7) >> 3) * pHeader->Height;
+        if ((uint64_t)pHeader->IndexOffset + (uint64_t)pHeader->IndexCount * sizeof(uint16_t) > nSize ||
+            (uint64_t)pHeader->DataOffset + (uint64_t)pHeader->GlyphCount * nGlyphSize > nSize)
+        {
+            return false;
+        }
+
+        // 两级索引的页表指向的页不能超出索引表
+        const uint16_t* pIndex = (const uint16_t*)(pBuffer + pHeader->IndexOffset);
+        uint32_t nFirstSlot = 0;
+        if (pHeader->Flags & GlyphBankTwoLevelIndex)
+        {
+            if (pHeader->IndexCount < GlyphBankPageSize || pHeader->IndexCount % GlyphBankPageSize != 0)
+            {
+                return false;
+            }
+            for (uint32_t i = 0; i < GlyphBankPageSize; ++i)
+            {
+                if (pIndex[i] >= pHeader->IndexCount / GlyphBankPageSize)
+                {
+                    return false;
+                }
+            }
+            nFirstSlot = GlyphBankPageSize;
+        }
+
+        // 索引指向的存储位置不能超出字符数量
+        for (uint32_t i = nFirstSlot; i < pHeader->IndexCount; ++i)
+        {
+            if (pIndex[i] > pHeader->GlyphCount)
+            {
+                return false;
+            }
+        }
+
+        this->Header = pHeader;
+        this->Index = pIndex;
+        this->Data = pBuffer + pHeader->DataOffset;
+        this->GlyphSize = (size_t)nGlyphSize;
+        return true;
+    }
+} // namespace H3FontExtension
@@ -0,0 +1,220 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace H3FontExtension
+{
+    // GBK字符数量 (0x81..0xFE) * (0x40..0xFE)
+    constexpr int GbkGlyphCount = 0x7E * 0xBF;
+
+    /**
+     * @brief GBK字符序号
+     * @param section 区码
+     * @param position 位码
+     * @return 字符序号
+     */
+    constexpr int GetGbkGlyphIndex(uint8_t section, uint8_t position)
+    {
+        return (section - 0x81) * 0xBF + position - 0x40;
+    }
+
+#pragma pack(push, 1)
+    /**
+     * @brief 索引字库文件头
+     * 文件结构：文件头 | 索引表 uint16[IndexCount] | 字符数据
+     * 一级索引：字符序号 -> 存储位置 + 1，0表示不存在
+     * 两级索引：页表 uint16[256]（高8位 -> 页号 + 1）| 页 uint16[256]（低8位 -> 存储位置 + 1），只存储有字符的页
+     * 字符数据可以按任意顺序存放，用于热点字符重排与子集字库
+     * 距离场字库的字符为8位有符号距离，128为边缘，字符框四周各留 FieldPadding 像素，绘制时按配置尺寸采样
+     */
+    struct GlyphBankHeader
+    {
+        char Magic[4];
+        uint16_t Version;
+        uint16_t Flags;
+        uint16_t Width;
+        uint16_t Height;
+        uint8_t BitDepth;
+        // 距离场字库字符框四周的填充像素
+        uint8_t FieldPadding;
+        // 距离场字库中 127 级对应的距离（像素）
+        uint8_t FieldSpread;
+        uint8_t Reserved;
+        uint32_t IndexCount;
+        uint32_t GlyphCount;
+        uint32_t IndexOffset;
+        uint32_t DataOffset;
+    };
+#pragma pack(pop)
+
+    constexpr char GlyphBankMagic[4] = {'H', '3', 'G', 'B'};
+    constexpr uint16_t GlyphBankVersion = 1;
+
+    // 两级索引
+    constexpr uint16_t GlyphBankTwoLevelIndex = 0x0001;
+    // 按Unicode码位索引，否则按GBK字符序号索引
+    constexpr uint16_t GlyphBankUnicodeKeys = 0x0002;
+    // 距离场字库，位深为8
+    constexpr uint16_t GlyphBankDistanceField = 0x0004;
+    // 索引键上限，两级索引每页256项
+    constexpr int GlyphBankMaxKey = 0x10000;
+    constexpr int GlyphBankPageSize = 0x100;
+
+    /**
+     * @brief 索引字库只读视图
+     */
+    struct GlyphBankView
+    {
+        const GlyphBankHeader* Header = nullptr;
+        const uint16_t* Index = nullptr;
+        const uint8_t* Data = nullptr;
+        size_t GlyphSize = 0;
+
+        /**
+         * @brief 解析索引字库，校验文件头与数据范围
+         * @param pBuffer 文件内容
+         * @param nSize 文件大小
+         * @return 是否为有效的索引字库
+         */
+        bool Parse(const uint8_t* pBuffer, size_t nSize);
+
+        /**
+         * @brief 是否按Unicode码位索引
+         */
+        bool IsUnicode() const
+        {
+            return Header->Flags & GlyphBankUnicodeKeys;
+        }
+
+        /**
+         * @brief 是否为距离场字库
+         */
+        bool IsDistanceField() const
+        {
+            return Header->Flags & GlyphBankDistanceField;
+        }
+
+        /**
+         * @brief 查找字符
+         * @param nKey 字符序号或Unicode码位
+         * @return 字符数据，不存在时返回nullptr
+         */
+        const uint8_t* Find(int nKey) const
+        {
+            uint16_t nSlot = 0;
+            if (Header->Flags & GlyphBankTwoLevelIndex)
+            {
+                if ((unsigned)nKey >= GlyphBankMaxKey)
+                {
+                    return nullptr;
+                }
+                uint16_t nPage = Index[nKey >> 8];
+                if (nPage == 0)
+                {
+                    return nullptr;
+                }
+                nSlot = Index[nPage * GlyphBankPageSize + (nKey & 0xFF)];
+            }
+            else if ((unsigned)nKey < Header->IndexCount)
+            {
+                nSlot = Index[nKey];
+            }
+
+            return nSlot ? Data + (nSlot - 1) * GlyphSize : nullptr;
+        }
+    };
+
+    /**
+     * @brief 生成索引表，自动选择占用较小的一级或两级索引
+     * @param keys 按存储顺序排列的索引键
+     * @param nFlags 输出索引类型标志
+     * @return 索引表
+     */
+    inline std::vector<uint16_t> BuildGlyphIndex(const std::vector<int>& keys, uint16_t& nFlags)
+    {
+        int nMaxKey = -1;
+        std::vector<bool> pages(GlyphBankMaxKey / GlyphBankPageSize);
+        for (int nKey : keys)
+        {
+            nMaxKey = std::max(nMaxKey, nKey);
+            pages[nKey >> 8] = true;
+        }
+        size_t nPageCount = std::count(pages.begin(), pages.end(), true);
+
+        std::vector<uint16_t> index;
+        if ((size_t)nMaxKey + 1 <= (nPageCount + 1) * GlyphBankPageSize)
+        {
+            nFlags &= ~GlyphBankTwoLevelIndex;
+            index.resize(nMaxKey + 1);
+            for (size_t nSlot = 0; nSlot < keys.size(); ++nSlot)
+            {
+                index[keys[nSlot]] = (uint16_t)(nSlot + 1);
+            }
+            return index;
+        }
+
+        // 页表之后依次存放有字符的页，页号从1开始
+        nFlags |= GlyphBankTwoLevelIndex;
+        index.resize(GlyphBankPageSize);
+        for (size_t nPage = 0; nPage < pages.size(); ++nPage)
+        {
+            if (pages[nPage])
+            {
+                index[nPage] = (uint16_t)(index.size() / GlyphBankPageSize);
+                index.resize(index.size() + GlyphBankPageSize);
+            }
+        }
+        for (size_t nSlot = 0; nSlot < keys.size(); ++nSlot)
+        {
+            index[index[keys[nSlot] >> 8] * GlyphBankPageSize + (keys[nSlot] & 0xFF)] = (uint16_t)(nSlot + 1);
+        }
+        return index;
+    }
+
+    /**
+     * @brief 生成索引字库
+     * @param nWidth 字宽
+     * @param nHeight 字高
+     * @param nBitDepth 位深
+     * @param nFlags 索引键类型 GlyphBankUnicodeKeys，索引结构自动选择
+     * @param order 按存储顺序排列的索引键，小于 GlyphBankMaxKey
+     * @param glyphs 按索引键读取字符数据
+     * @return 文件内容
+     */
+    template <typename TGlyphs>
+    std::vector<uint8_t> BuildGlyphBank(int nWidth, int nHeight, int nBitDepth, uint16_t nFlags,
+                                        const std::vector<int>& order, TGlyphs&& glyphs)
+    {
+        size_t nGlyphSize = ((nWidth * nBitDepth + 7) >> 3) * nHeight;
+        std::vector<uint16_t> index = BuildGlyphIndex(order, nFlags);
+
+        GlyphBankHeader header{};
+        for (int i = 0; i < 4; ++i)
+        {
+            header.Magic[i] = GlyphBankMagic[i];
+        }
+        header.Version = GlyphBankVersion;
+        header.Flags = nFlags;
+        header.Width = (uint16_t)nWidth;
+        header.Height = (uint16_t)nHeight;
+        header.BitDepth = (uint8_t)nBitDepth;
+        header.IndexCount = (uint32_t)index.size();
+        header.GlyphCount = (uint32_t)order.size();
+        header.IndexOffset = sizeof(GlyphBankHeader);
+        header.DataOffset = header.IndexOffset + header.IndexCount * sizeof(uint16_t);
+
+        std::vector<uint8_t> file(header.DataOffset + order.size() * nGlyphSize);
+        *(GlyphBankHeader*)file.data() = header;
+        std::copy(index.begin(), index.end(), (uint16_t*)(file.data() + header.IndexOffset));
+        for (size_t nSlot = 0; nSlot < order.size(); ++nSlot)
+        {
+            const uint8_t* pGlyph = glyphs(order[nSlot]);
+            std::copy(pGlyph, pGlyph + nGlyphSize, file.data() + header.DataOffset + nSlot * nGlyphSize);
+        }
+
+        return file;
+    }
+} // namespace H3FontExtension
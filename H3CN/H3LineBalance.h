@@ -0,0 +1,31 @@
+#pragma once
+
+#include <algorithm>
+
+namespace H3FontExtension
+{
+    /**
+     * @brief 求行数不超过最大行宽下行数的最小行宽
+     * 单词回退与悬挂标点使行数不随行宽单调变化，二分查找可能错过更窄的行宽
+     * 拆分只把行宽用于比较，行宽 w 的拆分在 [拆分结果不变的最小行宽, w] 内相同，从最大行宽逐段向下枚举每种不同的拆分
+     * @param nMinWidth 最小行宽
+     * @param nMaxWidth 最大行宽
+     * @param split 拆分 split(行宽, 输出拆分结果不变的最小行宽)，返回行数
+     * @return 行宽
+     */
+    template <typename TSplit>
+    int GetMinimumSplitWidth(int nMinWidth, int nMaxWidth, TSplit&& split)
+    {
+        int nSameSplitWidth = 0;
+        int lineCount = split(nMaxWidth, nSameSplitWidth);
+        int nBestWidth = std::max(nSameSplitWidth, nMinWidth);
+        for (int nWidth = nSameSplitWidth - 1; nWidth >= nMinWidth; nWidth = nSameSplitWidth - 1)
+        {
+            if (split(nWidth, nSameSplitWidth) <= lineCount)
+            {
+                nBestWidth = std::max(nSameSplitWidth, nMinWidth);
+            }
+        }
+        return nBestWidth;
+    }
+} // namespace H3FontExtension
@@ -0,0 +1,347 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <type_traits>
+#include <utility>
+
+// x86 目标默认启用 SSE2（MSVC /arch:SSE2）
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define H3_TEXT_SSE2
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+namespace H3FontExtension
+{
+    // 字节分类表，按字节值索引
+    using ByteTable = std::array<bool, 256>;
+
+    /**
+     * @brief 生成字节分类表
+     * @param ranges 闭区间列表
+     * @return 字节分类表
+     */
+    constexpr ByteTable MakeByteTable(std::initializer_list<std::pair<int, int>> ranges)
+    {
+        ByteTable table{};
+        for (const auto& [nFirst, nLast] : ranges)
+        {
+            for (int i = nFirst; i <= nLast; ++i)
+            {
+                table[i] = true;
+            }
+        }
+        return table;
+    }
+
+    // 字符字节数表，按首字节索引，1表示使用ASCII字体的单字节字符
+    using CharLengthTable = std::array<uint8_t, 256>;
+
+    /**
+     * @brief 生成字符字节数表
+     * @param ranges 首字节闭区间与字节数列表
+     * @return 字符字节数表
+     */
+    constexpr CharLengthTable MakeCharLengthTable(std::initializer_list<std::array<int, 3>> ranges)
+    {
+        CharLengthTable table{};
+        table.fill(1);
+        for (const auto& [nFirst, nLast, nLength] : ranges)
+        {
+            for (int i = nFirst; i <= nLast; ++i)
+            {
+                table[i] = (uint8_t)nLength;
+            }
+        }
+        return table;
+    }
+
+    /**
+     * @brief 编码的字库布局，字库按 (高位 - LeadFirst) * 低位数量 + (低位 - TrailFirst) 稠密存放
+     * Unicode编码的字符序号即为码位，布局为 0x00..0xFF * 0x00..0xFF
+     * 仅用于非逐字节的路径：缓存大小、频率统计、Unicode转换
+     */
+    struct TextEncodingInfo
+    {
+        const char* Name;
+        // Windows代码页，用于转换为Unicode码位
+        int CodePage;
+        uint8_t LeadFirst;
+        uint8_t LeadLast;
+        uint8_t TrailFirst;
+        uint8_t TrailLast;
+        // 字符序号为Unicode码位
+        bool Unicode = false;
+
+        constexpr int GetTrailCount() const
+        {
+            return TrailLast - TrailFirst + 1;
+        }
+
+        constexpr int GetGlyphCount() const
+        {
+            return (LeadLast - LeadFirst + 1) * GetTrailCount();
+        }
+
+        constexpr int GetGlyphIndex(uint8_t lead, uint8_t trail) const
+        {
+            return (lead - LeadFirst) * GetTrailCount() + trail - TrailFirst;
+        }
+
+        constexpr uint8_t GetLeadByte(int nIndex) const
+        {
+            return (uint8_t)(nIndex / GetTrailCount() + LeadFirst);
+        }
+
+        constexpr uint8_t GetTrailByte(int nIndex) const
+        {
+            return (uint8_t)(nIndex % GetTrailCount() + TrailFirst);
+        }
+    };
+
+    /*
+     * 编码策略：文本引擎以编码策略为模板参数实例化，按 H3CN.toml 的 Encoding 选择，逐字节处理时没有编码分支
+     * Info           字库布局
+     * CharLengths    按首字节确定的字符字节数，多字节字符使用扩展字体
+     * TrailBytes     有效的后续字节
+     * GetGlyphIndex  多字节字符在字库中的序号，调用方保证字符完整有效，字库范围外的字符返回-1
+     */
+
+    /**
+     * @brief 双字节编码
+     */
+    template <typename TEncoding>
+    struct DoubleByteEncoding
+    {
+        static constexpr int GetGlyphIndex(const uint8_t* pChar)
+        {
+            return TEncoding::Info.GetGlyphIndex(pChar[0], pChar[1]);
+        }
+    };
+
+    /**
+     * @brief 简体中文 GBK，高位 0x81..0xFE，低位 0x40..0xFE（不含 0x7F）
+     */
+    struct GbkEncoding : DoubleByteEncoding<GbkEncoding>
+    {
+        static constexpr TextEncodingInfo Info{"GBK", 936, 0x81, 0xFE, 0x40, 0xFE};
+        static constexpr CharLengthTable CharLengths = MakeCharLengthTable({{0x81, 0xFE, 2}});
+        static constexpr ByteTable TrailBytes = MakeByteTable({{0x40, 0x7E}, {0x80, 0xFE}});
+    };
+
+    /**
+     * @brief 繁体中文 Big5
+     */
+    struct Big5Encoding : DoubleByteEncoding<Big5Encoding>
+    {
+        static constexpr TextEncodingInfo Info{"Big5", 950, 0x81, 0xFE, 0x40, 0xFE};
+        static constexpr CharLengthTable CharLengths = MakeCharLengthTable({{0x81, 0xFE, 2}});
+        static constexpr ByteTable TrailBytes = MakeByteTable({{0x40, 0x7E}, {0xA1, 0xFE}});
+    };
+
+    /**
+     * @brief 日文 Shift-JIS，半角片假名 0xA1..0xDF 为单字节
+     */
+    struct ShiftJisEncoding : DoubleByteEncoding<ShiftJisEncoding>
+    {
+        static constexpr TextEncodingInfo Info{"Shift-JIS", 932, 0x81, 0xFC, 0x40, 0xFC};
+        static constexpr CharLengthTable CharLengths = MakeCharLengthTable({{0x81, 0x9F, 2}, {0xE0, 0xFC, 2}});
+        static constexpr ByteTable TrailBytes = MakeByteTable({{0x40, 0x7E}, {0x80, 0xFC}});
+    };
+
+    /**
+     * @brief 韩文 CP949 (UHC)
+     */
+    struct Cp949Encoding : DoubleByteEncoding<Cp949Encoding>
+    {
+        static constexpr TextEncodingInfo Info{"CP949", 949, 0x81, 0xFE, 0x41, 0xFE};
+        static constexpr CharLengthTable CharLengths = MakeCharLengthTable({{0x81, 0xFE, 2}});
+        static constexpr ByteTable TrailBytes = MakeByteTable({{0x41, 0x5A}, {0x61, 0x7A}, {0x81, 0xFE}});
+    };
+
+    /**
+     * @brief UTF-8，字符序号为Unicode码位，仅支持基本多文种平面
+     * 按Unicode码位索引的字库直接查找，其他字库经Unicode到GBK转换表查找
+     */
+    struct Utf8Encoding
+    {
+        static constexpr TextEncodingInfo Info{"UTF-8", 65001, 0x00, 0xFF, 0x00, 0xFF, true};
+        static constexpr CharLengthTable CharLengths =
+            MakeCharLengthTable({{0xC2, 0xDF, 2}, {0xE0, 0xEF, 3}, {0xF0, 0xF4, 4}});
+        static constexpr ByteTable TrailBytes = MakeByteTable({{0x80, 0xBF}});
+
+        /**
+         * @brief 第二字节的有效范围随首字节收窄，排除超长编码（E0、F0）、代理码位（ED）与超出 U+10FFFF 的码位（F4）
+         */
+        static constexpr bool IsValidSecondByte(uint8_t nLead, uint8_t nSecond)
+        {
+            switch (nLead)
+            {
+            case 0xE0:
+                return nSecond >= 0xA0;
+            case 0xED:
+                return nSecond <= 0x9F;
+            case 0xF0:
+                return nSecond >= 0x90;
+            case 0xF4:
+                return nSecond <= 0x8F;
+            default:
+                return true;
+            }
+        }
+
+        static constexpr int GetGlyphIndex(const uint8_t* pChar)
+        {
+            constexpr uint8_t leadMask[5] = {0, 0x7F, 0x1F, 0x0F, 0x07};
+            int nLength = CharLengths[pChar[0]];
+            int nCodePoint = pChar[0] & leadMask[nLength];
+            for (int i = 1; i < nLength; ++i)
+            {
+                nCodePoint = nCodePoint << 6 | (pChar[i] & 0x3F);
+            }
+            return nCodePoint < 0x10000 ? nCodePoint : -1;
+        }
+    };
+
+    /**
+     * @brief 字符字节数
+     */
+    template <typename TEncoding>
+    constexpr int GetCharLength(uint8_t nChar)
+    {
+        return TEncoding::CharLengths[nChar];
+    }
+
+    /**
+     * @brief 是否为多字节字符首字节
+     */
+    template <typename TEncoding>
+    constexpr bool IsLeadByte(uint8_t nChar)
+    {
+        return TEncoding::CharLengths[nChar] > 1;
+    }
+
+    /**
+     * @brief 有效字符的字节数，逐字节查表校验后续字节，遇到第一个无效字节即停止读取
+     * @param pChar 字符首字节
+     * @param nRemaining 剩余字节数，以0结尾的文本可传入 SIZE_MAX，结尾的0不是有效的后续字节
+     * @return 完整有效的多字节字符返回其字节数，否则返回1，多字节首字节单独绘制为替换字符
+     */
+    template <typename TEncoding>
+    constexpr int GetValidCharLength(const uint8_t* pChar, size_t nRemaining)
+    {
+        int nLength = TEncoding::CharLengths[pChar[0]];
+        if ((size_t)nLength > nRemaining)
+        {
+            return 1;
+        }
+        for (int i = 1; i < nLength; ++i)
+        {
+            if (!TEncoding::TrailBytes[pChar[i]])
+            {
+                return 1;
+            }
+        }
+        if constexpr (std::is_same_v<TEncoding, Utf8Encoding>)
+        {
+            if (nLength > 1 && !Utf8Encoding::IsValidSecondByte(pChar[0], pChar[1]))
+            {
+                return 1;
+            }
+        }
+        return nLength;
+    }
+
+    /**
+     * @brief 是否为普通ASCII字符：不是多字节首字节、0xFF、标记 {}、换行符或结束符，按ASCII字体字宽排版
+     */
+    constexpr bool IsPlainAscii(uint8_t nChar)
+    {
+        return nChar < 0x80 && nChar != '{' && nChar != '}' && nChar != '\n' && nChar != 0;
+    }
+
+    /**
+     * @brief 文本开头连续的普通ASCII字符数量，测量、拆分与绘制在该范围内跳过标记与多字节字符的判断
+     * SSE2 每次检查16字节，只读取 nLength 范围内的字节
+     * @param pText 文本
+     * @param nLength 文本长度
+     * @return 普通ASCII字符数量
+     */
+    inline size_t CountPlainAsciiRun(const uint8_t* pText, size_t nLength)
+    {
+        size_t i = 0;
+#ifdef H3_TEXT_SSE2
+        const __m128i openBrace = _mm_set1_epi8('{');
+        const __m128i closeBrace = _mm_set1_epi8('}');
+        const __m128i newLine = _mm_set1_epi8('\n');
+        const __m128i zero = _mm_setzero_si128();
+        for (; i + 16 <= nLength; i += 16)
+        {
+            __m128i bytes = _mm_loadu_si128((const __m128i*)(pText + i));
+            __m128i braces = _mm_or_si128(_mm_cmpeq_epi8(bytes, openBrace), _mm_cmpeq_epi8(bytes, closeBrace));
+            __m128i ends = _mm_or_si128(_mm_cmpeq_epi8(bytes, newLine), _mm_cmpeq_epi8(bytes, zero));
+            // 字节最高位即为非ASCII
+            int nMask = _mm_movemask_epi8(_mm_or_si128(bytes, _mm_or_si128(braces, ends)));
+            if (nMask)
+            {
+#ifdef _MSC_VER
+                unsigned long nIndex;
+                _BitScanForward(&nIndex, (unsigned long)nMask);
+                return i + nIndex;
+#else
+                return i + __builtin_ctz((unsigned)nMask);
+#endif
+            }
+        }
+#endif
+        while (i < nLength && IsPlainAscii(pText[i]))
+        {
+            ++i;
+        }
+        return i;
+    }
+
+    /**
+     * @brief 双字节编码的有效字符均位于字库范围内
+     */
+    template <typename TEncoding>
+    constexpr bool IsGlyphRangeValid()
+    {
+        for (int nLead = 0; nLead < 256; ++nLead)
+        {
+            if (TEncoding::CharLengths[nLead] != 2)
+            {
+                continue;
+            }
+            for (int nTrail = 0; nTrail < 256; ++nTrail)
+            {
+                if (TEncoding::TrailBytes[nTrail] &&
+                    (nLead < TEncoding::Info.LeadFirst || nLead > TEncoding::Info.LeadLast ||
+                     nTrail < TEncoding::Info.TrailFirst || nTrail > TEncoding::Info.TrailLast))
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief 多字节字符在字库中的序号
+     */
+    template <typename TEncoding>
+    constexpr int GetGlyphIndex(const uint8_t* pChar)
+    {
+        return TEncoding::GetGlyphIndex(pChar);
+    }
+
+    static_assert(GbkEncoding::Info.GetGlyphCount() == 0x7E * 0xBF);
+    static_assert(IsGlyphRangeValid<GbkEncoding>() && IsGlyphRangeValid<Big5Encoding>() &&
+                  IsGlyphRangeValid<ShiftJisEncoding>() && IsGlyphRangeValid<Cp949Encoding>());
+    static_assert(Utf8Encoding::Info.GetGlyphCount() == 0x10000);
+} // namespace H3FontExtension
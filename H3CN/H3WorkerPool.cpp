@@ -0,0 +1,157 @@
+#include "H3WorkerPool.h"
+
+using namespace std;
+
+namespace H3FontExtension
+{
+    WorkerPool::WorkerPool(size_t nThreads)
+    {
+        if (nThreads == 0)
+        {
+            nThreads = max(thread::hardware_concurrency(), 2u) - 1;
+        }
+
+        for (size_t i = 0; i < nThreads; ++i)
+        {
+            Queues.push_back(make_unique<WorkerQueue>());
+        }
+        for (size_t i = 0; i < nThreads; ++i)
+        {
+            Workers.emplace_back(&WorkerPool::WorkerLoop, this, i);
+        }
+    }
+
+    WorkerPool::~WorkerPool()
+    {
+        {
+            lock_guard<mutex> lock(SleepMutex);
+            Stopping = true;
+        }
+        SleepCondition.notify_all();
+        for (thread& worker : Workers)
+        {
+            worker.join();
+        }
+    }
+
+    void WorkerPool::Submit(Task task)
+    {
+        // 先计数再入队，保证计数不会因任务被提前取走而下溢
+        {
+            lock_guard<mutex> lock(SleepMutex);
+            ++PendingTasks;
+        }
+
+        size_t nIndex = NextQueue++ % Workers.size();
+        {
+            lock_guard<mutex> lock(Queues[nIndex]->Mutex);
+            Queues[nIndex]->Tasks.push_back(std::move(task));
+        }
+        SleepCondition.notify_one();
+    }
+
+    bool WorkerPool::TryPop(size_t nIndex, Task& task)
+    {
+        WorkerQueue& queue = *Queues[nIndex];
+        lock_guard<mutex> lock(queue.Mutex);
+        if (queue.Tasks.empty())
+        {
+            return false;
+        }
+        task = std::move(queue.Tasks.front());
+        queue.Tasks.pop_front();
+        return true;
+    }
+
+    bool WorkerPool::TrySteal(size_t nIndex, Task& task)
+    {
+        for (size_t i = 1; i < Queues.size(); ++i)
+        {
+            WorkerQueue& queue = *Queues[(nIndex + i) % Queues.size()];
+            lock_guard<mutex> lock(queue.Mutex);
+            if (queue.Tasks.empty())
+            {
+                continue;
+            }
+            task = std::move(queue.Tasks.back());
+            queue.Tasks.pop_back();
+            return true;
+        }
+        return false;
+    }
+
+    void WorkerPool::WorkerLoop(size_t nIndex)
+    {
+        for (;;)
+        {
+            Task task;
+            if (TryPop(nIndex, task) || TrySteal(nIndex, task))
+            {
+                --PendingTasks;
+                task();
+                continue;
+            }
+
+            unique_lock<mutex> lock(SleepMutex);
+            SleepCondition.wait(lock, [this] { return Stopping || PendingTasks > 0; });
+            if (Stopping)
+            {
+                return;
+            }
+        }
+    }
+
+    void WorkerPool::ParallelFor(size_t nCount, const function<void(size_t)>& func)
+    {
+        if (nCount == 0)
+        {
+            return;
+        }
+
+        // 完成状态由任务共同持有，调用线程返回后仍在队列中的任务只读取状态，不再调用 func
+        struct ForState
+        {
+            const function<void(size_t)>* pFunc = nullptr;
+            size_t nCount = 0;
+            atomic<size_t> nNext = 0;
+            atomic<size_t> nDone = 0;
+            mutex DoneMutex;
+            condition_variable DoneCondition;
+        };
+        auto state = make_shared<ForState>();
+        state->pFunc = &func;
+        state->nCount = nCount;
+
+        // 每个任务依次领取序号执行，直到全部序号被领取
+        auto runTasks = [](ForState& forState) {
+            for (size_t i = forState.nNext++; i < forState.nCount; i = forState.nNext++)
+            {
+                (*forState.pFunc)(i);
+                if (++forState.nDone == forState.nCount)
+                {
+                    lock_guard<mutex> lock(forState.DoneMutex);
+                    forState.DoneCondition.notify_all();
+                }
+            }
+        };
+
+        size_t nHelpers = min(nCount - 1, Workers.size());
+        for (size_t i = 0; i < nHelpers; ++i)
+        {
+            Submit([state, runTasks] { runTasks(*state); });
+        }
+
+        // 调用线程只执行本次的序号，不执行队列中的其他任务（字库加载、预缩放等）
+        runTasks(*state);
+
+        unique_lock<mutex> lock(state->DoneMutex);
+        state->DoneCondition.wait(lock, [&] { return state->nDone == nCount; });
+    }
+
+    WorkerPool& GetWorkerPool()
+    {
+        // 进程退出时工作线程已被系统终止，不析构线程池
+        static WorkerPool* pool = new WorkerPool(WorkerThreads);
+        return *pool;
+    }
+} // namespace H3FontExtension
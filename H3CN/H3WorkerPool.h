@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace H3FontExtension
+{
+    /**
+     * @brief 工作窃取线程池，每个线程拥有独立任务队列，空闲时从其他线程队列尾部窃取任务
+     */
+    class WorkerPool
+    {
+    public:
+        typedef std::function<void()> Task;
+
+        /**
+         * @brief 创建线程池
+         * @param nThreads 工作线程数量，0表示使用CPU核心数减一
+         */
+        explicit WorkerPool(size_t nThreads = 0);
+        ~WorkerPool();
+
+        WorkerPool(const WorkerPool&) = delete;
+        WorkerPool& operator=(const WorkerPool&) = delete;
+
+        /**
+         * @brief 提交异步任务
+         * @param task 任务
+         */
+        void Submit(Task task);
+
+        /**
+         * @brief 并行执行 func(0..nCount-1)，调用线程同时参与执行，全部完成后返回
+         * @param nCount 任务数量
+         * @param func 任务函数
+         */
+        void ParallelFor(size_t nCount, const std::function<void(size_t)>& func);
+
+        /**
+         * @brief 工作线程数量
+         */
+        size_t Size() const
+        {
+            return Workers.size();
+        }
+
+    private:
+        struct WorkerQueue
+        {
+            std::mutex Mutex;
+            std::deque<Task> Tasks;
+        };
+
+        void WorkerLoop(size_t nIndex);
+        bool TryPop(size_t nIndex, Task& task);
+        bool TrySteal(size_t nIndex, Task& task);
+
+        std::vector<std::unique_ptr<WorkerQueue>> Queues;
+        std::vector<std::thread> Workers;
+        std::mutex SleepMutex;
+        std::condition_variable SleepCondition;
+        std::atomic<size_t> PendingTasks = 0;
+        std::atomic<size_t> NextQueue = 0;
+        bool Stopping = false;
+    };
+
+    // 全局线程池，首次使用时创建
+    WorkerPool& GetWorkerPool();
+
+    // 工作线程数量，0表示使用CPU核心数减一
+    inline size_t WorkerThreads = 0;
+} // namespace H3FontExtension
@@ -0,0 +1,1466 @@
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "H3Glyph.h"
+#include "H3GlyphBank.h"
+#include "H3GlyphBands.h"
+#include "H3LineBalance.h"
+#include "H3TextEncoding.h"
+#include "H3WorkerPool.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <iconv.h>
+#endif
+
+using namespace std;
+using namespace H3FontExtension;
+
+namespace
+{
+    /**
+     * @brief GBK字符对应的Unicode码位
+     * @param nIndex GBK字符序号
+     * @return Unicode码位，无对应字符时返回-1
+     */
+    int GbkToCodePoint(int nIndex)
+    {
+        char gbk[2] = {(char)(nIndex / 0xBF + 0x81), (char)(nIndex % 0xBF + 0x40)};
+#ifdef _WIN32
+        wchar_t unicode[2];
+        if (MultiByteToWideChar(936, MB_ERR_INVALID_CHARS, gbk, 2, unicode, 2) != 1)
+        {
+            return -1;
+        }
+        return unicode[0];
+#else
+        static iconv_t converter = iconv_open("UTF-16LE", "GBK");
+        char16_t unicode[2];
+        char* pIn = gbk;
+        char* pOut = (char*)unicode;
+        size_t nIn = 2;
+        size_t nOut = sizeof(unicode);
+        if (iconv(converter, &pIn, &nIn, &pOut, &nOut) == (size_t)-1 || nOut != sizeof(char16_t))
+        {
+            iconv(converter, nullptr, nullptr, nullptr, nullptr);
+            return -1;
+        }
+        return unicode[0];
+#endif
+    }
+
+    /**
+     * @brief 字库，兼容普通HZK字库与索引字库
+     */
+    struct SourceBank
+    {
+        vector<uint8_t> Buffer;
+        GlyphBankView Bank;
+        int Width = 0;
+        int Height = 0;
+        int BitDepth = 8;
+        size_t GlyphSize = 0;
+
+        /**
+         * @brief 是否按Unicode码位索引
+         */
+        bool IsUnicode() const
+        {
+            return Bank.Header && Bank.IsUnicode();
+        }
+
+        /**
+         * @brief 索引键数量
+         */
+        int GetKeyCount() const
+        {
+            return IsUnicode() ? GlyphBankMaxKey : GbkGlyphCount;
+        }
+
+        /**
+         * @brief GBK字符对应的索引键
+         * @param nIndex GBK字符序号
+         * @return 索引键，无对应字符时返回-1
+         */
+        int GetKey(int nIndex) const
+        {
+            return IsUnicode() ? GbkToCodePoint(nIndex) : nIndex;
+        }
+
+        /**
+         * @brief 查找字符
+         * @param nIndex 索引键
+         * @return 字符数据，不存在时返回nullptr
+         */
+        const uint8_t* Find(int nIndex) const
+        {
+            if (Bank.Header)
+            {
+                return Bank.Find(nIndex);
+            }
+            if (nIndex < 0 || (size_t)(nIndex + 1) * GlyphSize > Buffer.size())
+            {
+                return nullptr;
+            }
+            return Buffer.data() + nIndex * GlyphSize;
+        }
+    };
+
+    bool ReadFile(const string& fileName, vector<uint8_t>& buffer)
+    {
+        ifstream file(fileName, ios::in | ios::binary);
+        if (!file.good())
+        {
+            return false;
+        }
+        buffer.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+        return true;
+    }
+
+    bool WriteFile(const string& fileName, const vector<uint8_t>& buffer)
+    {
+        ofstream file(fileName, ios::out | ios::binary);
+        file.write((const char*)buffer.data(), buffer.size());
+        return file.good();
+    }
+
+    /**
+     * @brief 读取字库，索引字库以文件头中的尺寸为准
+     */
+    bool LoadSourceBank(const string& fileName, int nWidth, int nHeight, int nBitDepth, SourceBank& bank)
+    {
+        if (!ReadFile(fileName, bank.Buffer))
+        {
+            cerr << "无法读取字库 " << fileName << endl;
+            return false;
+        }
+
+        if (bank.Bank.Parse(bank.Buffer.data(), bank.Buffer.size()))
+        {
+            bank.Width = bank.Bank.Header->Width;
+            bank.Height = bank.Bank.Header->Height;
+            bank.BitDepth = bank.Bank.Header->BitDepth;
+        }
+        else
+        {
+            bank.Width = nWidth;
+            bank.Height = nHeight;
+            bank.BitDepth = nBitDepth;
+        }
+        bank.GlyphSize = GetPackedGlyphSize(bank.Width, bank.Height, bank.BitDepth);
+        return true;
+    }
+
+    /**
+     * @brief 读取字符使用频率统计，格式与插件保存的一致，按字库的索引键累计
+     * 统计文件首行记录插件使用的编码，GBK编码（或没有记录）按GBK字符序号对应，UTF-8编码按码位对应Unicode字库
+     * @param fileName 文件名
+     * @param bank 字库
+     * @param profile 输出使用次数，按索引键索引
+     * @return 编码与字库匹配时返回true
+     */
+    bool LoadProfile(const string& fileName, const SourceBank& bank, vector<uint32_t>& profile)
+    {
+        ifstream file(fileName);
+        if (!file.good())
+        {
+            cerr << "无法读取频率统计 " << fileName << endl;
+            return false;
+        }
+
+        profile.assign(bank.GetKeyCount(), 0);
+        string encoding = GbkEncoding::Info.Name;
+        string line;
+        while (getline(file, line))
+        {
+            const string title = "字符使用频率统计：";
+            size_t nTitle = line.find(title);
+            if (line.starts_with('#') && nTitle != string::npos)
+            {
+                size_t nNameBegin = nTitle + title.length();
+                encoding = line.substr(nNameBegin, line.find("编码", nNameBegin) - nNameBegin);
+                if (encoding == Utf8Encoding::Info.Name && !bank.IsUnicode())
+                {
+                    cerr << "UTF-8编码的频率统计需要按Unicode码位索引的字库" << endl;
+                    return false;
+                }
+                if (encoding != GbkEncoding::Info.Name && encoding != Utf8Encoding::Info.Name)
+                {
+                    cerr << "不支持" << encoding << "编码的频率统计，仅支持GBK与UTF-8" << endl;
+                    return false;
+                }
+                continue;
+            }
+
+            unsigned nCode = 0;
+            uint32_t nCount = 0;
+            if (line.empty() || line[0] == '#' || sscanf(line.c_str(), "%x %u", &nCode, &nCount) != 2)
+            {
+                continue;
+            }
+
+            int nKey = -1;
+            if (encoding == Utf8Encoding::Info.Name)
+            {
+                nKey = (int)nCode;
+            }
+            else
+            {
+                int nIndex = GetGbkGlyphIndex(nCode >> 8, nCode & 0xFF);
+                nKey = nIndex >= 0 && nIndex < GbkGlyphCount ? bank.GetKey(nIndex) : -1;
+            }
+            if (nKey >= 0 && nKey < bank.GetKeyCount())
+            {
+                profile[nKey] += nCount;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief 按使用频率重排字库，热点字符集中在文件前部
+     * 用法：reorder 字库 字宽 字高 位深 频率统计 输出文件
+     */
+    int Reorder(int argc, char* argv[])
+    {
+        if (argc < 8)
+        {
+            cerr << "用法：H3FontTool reorder 字库 字宽 字高 位深 频率统计 输出文件" << endl;
+            return 1;
+        }
+
+        SourceBank bank;
+        if (!LoadSourceBank(argv[2], atoi(argv[3]), atoi(argv[4]), atoi(argv[5]), bank))
+        {
+            return 1;
+        }
+        vector<uint32_t> profile;
+        if (!LoadProfile(argv[6], bank, profile))
+        {
+            return 1;
+        }
+
+        vector<int> order;
+        for (int i = 0; i < bank.GetKeyCount(); ++i)
+        {
+            if (bank.Find(i))
+            {
+                order.push_back(i);
+            }
+        }
+
+        // 热点字符按使用次数降序，其余保持编码顺序
+        stable_sort(order.begin(), order.end(), [&](int left, int right) { return profile[left] > profile[right]; });
+        size_t nHotCount = count_if(order.begin(), order.end(), [&](int i) { return profile[i] > 0; });
+
+        vector<uint8_t> file = BuildGlyphBank(bank.Width, bank.Height, bank.BitDepth,
+                                              bank.IsUnicode() ? GlyphBankUnicodeKeys : 0, order,
+                                              [&](int i) { return bank.Find(i); });
+        if (!WriteFile(argv[7], file))
+        {
+            cerr << "无法写入 " << argv[7] << endl;
+            return 1;
+        }
+
+        // 原字库中热点字符分散在各处，统计需要访问的内存页数
+        const size_t nPageSize = 4096;
+        vector<bool> touched(bank.Buffer.size() / nPageSize + 1);
+        for (size_t i = 0; i < nHotCount; ++i)
+        {
+            size_t nOffset = bank.Find(order[i]) - bank.Buffer.data();
+            for (size_t nPage = nOffset / nPageSize; nPage <= (nOffset + bank.GlyphSize - 1) / nPageSize; ++nPage)
+            {
+                touched[nPage] = true;
+            }
+        }
+        size_t nHotBytes = nHotCount * bank.GlyphSize;
+        size_t nDataOffset = ((const GlyphBankHeader*)file.data())->DataOffset;
+        size_t nHotPages = nHotBytes ? (nDataOffset + nHotBytes - 1) / nPageSize - nDataOffset / nPageSize + 1 : 0;
+
+        printf("字符总数 %zu，热点字符 %zu，热点数据 %zu 字节\n", order.size(), nHotCount, nHotBytes);
+        printf("热点字符数据所在内存页：重排前 %zu 页，重排后 %zu 页\n",
+               (size_t)count(touched.begin(), touched.end(), true), nHotPages);
+        return 0;
+    }
+
+    /**
+     * @brief 统计文本中出现的GBK字符
+     * @param buffer 文本内容
+     * @param used 按字符序号标记是否出现
+     */
+    void ScanGbkText(const vector<uint8_t>& buffer, vector<bool>& used)
+    {
+        for (size_t i = 0; i < buffer.size(); ++i)
+        {
+            uint8_t lead = buffer[i];
+            if (lead < 0x81 || lead > 0xFE || i + 1 >= buffer.size())
+            {
+                continue;
+            }
+
+            uint8_t trail = buffer[i + 1];
+            if (trail >= 0x40 && trail <= 0xFE && trail != 0x7F)
+            {
+                used[GetGbkGlyphIndex(lead, trail)] = true;
+                ++i;
+            }
+        }
+    }
+
+    /**
+     * @brief 根据游戏文本生成子集字库，只保留文本中出现的字符
+     * 用法：subset 字库 字宽 字高 位深 输出文件 文本文件或目录...
+     */
+    int Subset(int argc, char* argv[])
+    {
+        if (argc < 8)
+        {
+            cerr << "用法：H3FontTool subset 字库 字宽 字高 位深 输出文件 文本文件或目录..." << endl;
+            return 1;
+        }
+
+        SourceBank bank;
+        if (!LoadSourceBank(argv[2], atoi(argv[3]), atoi(argv[4]), atoi(argv[5]), bank))
+        {
+            return 1;
+        }
+
+        vector<bool> gbkUsed(GbkGlyphCount);
+        size_t nFileCount = 0;
+        vector<uint8_t> buffer;
+        auto scanFile = [&](const filesystem::path& path) {
+            if (ReadFile(path.string(), buffer))
+            {
+                ScanGbkText(buffer, gbkUsed);
+                ++nFileCount;
+            }
+        };
+        for (int i = 7; i < argc; ++i)
+        {
+            if (filesystem::is_directory(argv[i]))
+            {
+                for (const auto& entry : filesystem::recursive_directory_iterator(argv[i]))
+                {
+                    if (entry.is_regular_file())
+                    {
+                        scanFile(entry.path());
+                    }
+                }
+            }
+            else
+            {
+                scanFile(argv[i]);
+            }
+        }
+
+        vector<bool> used(bank.GetKeyCount());
+        size_t nMissing = 0;
+        for (int i = 0; i < GbkGlyphCount; ++i)
+        {
+            int nKey = gbkUsed[i] ? bank.GetKey(i) : -1;
+            if (nKey >= 0 && bank.Find(nKey))
+            {
+                used[nKey] = true;
+            }
+            else if (gbkUsed[i])
+            {
+                ++nMissing;
+            }
+        }
+
+        vector<int> order;
+        for (int i = 0; i < bank.GetKeyCount(); ++i)
+        {
+            if (used[i])
+            {
+                order.push_back(i);
+            }
+        }
+
+        vector<uint8_t> file = BuildGlyphBank(bank.Width, bank.Height, bank.BitDepth,
+                                              bank.IsUnicode() ? GlyphBankUnicodeKeys : 0, order,
+                                              [&](int i) { return bank.Find(i); });
+        if (!WriteFile(argv[6], file))
+        {
+            cerr << "无法写入 " << argv[6] << endl;
+            return 1;
+        }
+
+        printf("扫描文本 %zu 个，使用字符 %zu 个，字库中缺少 %zu 个\n", nFileCount, order.size() + nMissing, nMissing);
+        printf("字库大小：%zu 字节 -> %zu 字节，减少 %.1f%%\n", bank.Buffer.size(), file.size(),
+               bank.Buffer.empty() ? 0.0 : 100.0 * (1.0 - (double)file.size() / bank.Buffer.size()));
+        return 0;
+    }
+
+    /**
+     * @brief 将GBK字库转换为按Unicode码位索引的两级索引字库
+     * 用法：unicode 字库 字宽 字高 位深 输出文件
+     */
+    int Unicode(int argc, char* argv[])
+    {
+        if (argc < 7)
+        {
+            cerr << "用法：H3FontTool unicode 字库 字宽 字高 位深 输出文件" << endl;
+            return 1;
+        }
+
+        SourceBank bank;
+        if (!LoadSourceBank(argv[2], atoi(argv[3]), atoi(argv[4]), atoi(argv[5]), bank))
+        {
+            return 1;
+        }
+        if (bank.IsUnicode())
+        {
+            cerr << "字库已按Unicode码位索引" << endl;
+            return 1;
+        }
+
+        vector<int> gbkIndices(GlyphBankMaxKey, -1);
+        vector<int> order;
+        for (int i = 0; i < GbkGlyphCount; ++i)
+        {
+            int nCodePoint = GbkToCodePoint(i);
+            if (nCodePoint >= 0 && gbkIndices[nCodePoint] < 0 && bank.Find(i))
+            {
+                gbkIndices[nCodePoint] = i;
+                order.push_back(nCodePoint);
+            }
+        }
+        ranges::sort(order);
+
+        vector<uint8_t> file = BuildGlyphBank(bank.Width, bank.Height, bank.BitDepth, GlyphBankUnicodeKeys, order,
+                                              [&](int nCodePoint) { return bank.Find(gbkIndices[nCodePoint]); });
+        if (!WriteFile(argv[6], file))
+        {
+            cerr << "无法写入 " << argv[6] << endl;
+            return 1;
+        }
+
+        const GlyphBankHeader* pHeader = (const GlyphBankHeader*)file.data();
+        printf("字符 %zu 个，%s，索引 %u 字节\n", order.size(),
+               pHeader->Flags & GlyphBankTwoLevelIndex ? "两级索引" : "一级索引",
+               (unsigned)(pHeader->IndexCount * sizeof(uint16_t)));
+        return 0;
+    }
+
+    /**
+     * @brief 由母版字库按面积平均缩放生成8位索引字库，用于预览插件中 MasterFont 的缩放效果
+     * 用法：scale 母版字库 字宽 字高 位深 目标字宽 目标字高 输出文件
+     */
+    int Scale(int argc, char* argv[])
+    {
+        if (argc < 9)
+        {
+            cerr << "用法：H3FontTool scale 母版字库 字宽 字高 位深 目标字宽 目标字高 输出文件" << endl;
+            return 1;
+        }
+
+        SourceBank bank;
+        if (!LoadSourceBank(argv[2], atoi(argv[3]), atoi(argv[4]), atoi(argv[5]), bank))
+        {
+            return 1;
+        }
+        int nWidth = atoi(argv[6]);
+        int nHeight = atoi(argv[7]);
+        if (nWidth <= 0 || nHeight <= 0)
+        {
+            cerr << "目标尺寸无效" << endl;
+            return 1;
+        }
+
+        vector<int> order;
+        for (int nKey = 0; nKey < bank.GetKeyCount(); ++nKey)
+        {
+            if (bank.Find(nKey))
+            {
+                order.push_back(nKey);
+            }
+        }
+
+        GlyphScaler scaler(bank.Width, bank.Height, nWidth, nHeight);
+        vector<uint8_t> coverage(bank.Width * bank.Height);
+        vector<uint8_t> scaled(order.size() * nWidth * nHeight);
+        auto start = chrono::steady_clock::now();
+        for (size_t i = 0; i < order.size(); ++i)
+        {
+            ExpandGlyph(bank.Find(order[i]), coverage.data(), bank.Width, bank.Height, bank.BitDepth);
+            scaler.Scale(coverage.data(), scaled.data() + i * nWidth * nHeight);
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        vector<uint8_t> file = BuildGlyphBank(nWidth, nHeight, 8, bank.IsUnicode() ? GlyphBankUnicodeKeys : 0, order,
+                                              [&, nSlot = (size_t)0](int) mutable {
+                                                  return scaled.data() + nSlot++ * nWidth * nHeight;
+                                              });
+        if (!WriteFile(argv[8], file))
+        {
+            cerr << "无法写入 " << argv[8] << endl;
+            return 1;
+        }
+
+        printf("字符 %zu 个，%dx%d -> %dx%d，耗时 %.1fms，%.0f 字符/秒\n", order.size(), bank.Width, bank.Height,
+               nWidth, nHeight, seconds * 1000, order.size() / max(seconds, 1e-9));
+        return 0;
+    }
+
+    /**
+     * @brief 测量文本行宽，与文本引擎的行宽测量一致：换行符重置行宽，标记 {} 不占宽度
+     * @param pText 文本
+     * @param nLength 文本长度
+     * @param asciiWidths ASCII字体字宽
+     * @param nGlyphWidth 多字节字符字宽
+     * @param bPlainRuns 连续的普通ASCII字符按 CountPlainAsciiRun 整段累加，否则逐字节判断
+     * @return 最大行宽
+     */
+    int MeasureUtf8Lines(const uint8_t* pText, size_t nLength, const array<int, 256>& asciiWidths, int nGlyphWidth,
+                         bool bPlainRuns)
+    {
+        int maxLineWidth = 0;
+        int curLineWidth = 0;
+        for (size_t i = 0; i < nLength; ++i)
+        {
+            uint8_t code = pText[i];
+            if (code == '\n')
+            {
+                maxLineWidth = max(curLineWidth, maxLineWidth);
+                curLineWidth = 0;
+                continue;
+            }
+            if (bPlainRuns && IsPlainAscii(code))
+            {
+                size_t nPlain = CountPlainAsciiRun(pText + i, nLength - i);
+                for (size_t j = 0; j < nPlain; ++j)
+                {
+                    curLineWidth += asciiWidths[pText[i + j]];
+                }
+                i += nPlain - 1;
+                continue;
+            }
+            if (code == '{' || code == '}')
+            {
+                continue;
+            }
+            if (IsLeadByte<Utf8Encoding>(code))
+            {
+                curLineWidth += nGlyphWidth;
+                i += GetValidCharLength<Utf8Encoding>(pText + i, nLength - i) - 1;
+            }
+            else
+            {
+                curLineWidth += asciiWidths[code];
+            }
+        }
+        return max(curLineWidth, maxLineWidth);
+    }
+
+    /**
+     * @brief UTF-8文本扫描吞吐量测试，对比逐字节判断与文本引擎使用的普通ASCII字符段跳过
+     * 用法：utf8bench 文本文件 [重复次数]
+     */
+    int Utf8Bench(int argc, char* argv[])
+    {
+        if (argc < 3)
+        {
+            cerr << "用法：H3FontTool utf8bench 文本文件 [重复次数]" << endl;
+            return 1;
+        }
+
+        vector<uint8_t> text;
+        if (!ReadFile(argv[2], text) || text.empty())
+        {
+            cerr << "无法读取 " << argv[2] << endl;
+            return 1;
+        }
+        int nRepeat = argc > 3 ? max(atoi(argv[3]), 1) : 100;
+
+        array<int, 256> asciiWidths;
+        for (int i = 0; i < 256; ++i)
+        {
+            asciiWidths[i] = 4 + i % 5;
+        }
+        const int nGlyphWidth = 12;
+
+        auto measure = [&](bool bPlainRuns, int& nWidth) {
+            auto start = chrono::steady_clock::now();
+            for (int i = 0; i < nRepeat; ++i)
+            {
+                nWidth = MeasureUtf8Lines(text.data(), text.size(), asciiWidths, nGlyphWidth, bPlainRuns);
+            }
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            return text.size() * (double)nRepeat / seconds / (1024 * 1024);
+        };
+
+        int nScalarWidth = 0;
+        int nRunWidth = 0;
+        double scalarSpeed = measure(false, nScalarWidth);
+        double runSpeed = measure(true, nRunWidth);
+        if (nScalarWidth != nRunWidth)
+        {
+            cerr << "行宽结果不一致：" << nScalarWidth << " " << nRunWidth << endl;
+            return 1;
+        }
+
+        size_t nPlain = count_if(text.begin(), text.end(), IsPlainAscii);
+        printf("文本 %zu 字节，最大行宽 %d，普通ASCII字符占比 %.1f%%\n", text.size(), nRunWidth,
+               100.0 * nPlain / text.size());
+        printf("逐字节扫描 %.1f MB/s，ASCII字符段跳过 %.1f MB/s，加速 %.2fx\n", scalarSpeed, runSpeed,
+               runSpeed / scalarSpeed);
+        return 0;
+    }
+
+    /**
+     * @brief 保存32位像素为24位BMP
+     */
+    bool WriteBitmap(const string& fileName, const vector<uint32_t>& pixels, int nWidth, int nHeight)
+    {
+        int nPitch = (nWidth * 3 + 3) & ~3;
+        vector<uint8_t> file(54 + nPitch * nHeight);
+        auto put32 = [&](size_t nOffset, uint32_t nValue) {
+            for (int i = 0; i < 4; ++i)
+            {
+                file[nOffset + i] = (uint8_t)(nValue >> (i * 8));
+            }
+        };
+        file[0] = 'B';
+        file[1] = 'M';
+        put32(2, (uint32_t)file.size());
+        put32(10, 54);
+        put32(14, 40);
+        put32(18, nWidth);
+        put32(22, nHeight);
+        file[26] = 1;
+        file[28] = 24;
+        for (int nRow = 0; nRow < nHeight; ++nRow)
+        {
+            uint8_t* pRow = file.data() + 54 + (nHeight - 1 - nRow) * nPitch;
+            for (int nColumn = 0; nColumn < nWidth; ++nColumn)
+            {
+                uint32_t nPixel = pixels[nRow * nWidth + nColumn];
+                pRow[nColumn * 3] = (uint8_t)nPixel;
+                pRow[nColumn * 3 + 1] = (uint8_t)(nPixel >> 8);
+                pRow[nColumn * 3 + 2] = (uint8_t)(nPixel >> 16);
+            }
+        }
+        return WriteFile(fileName, file);
+    }
+
+    /**
+     * @brief 文字混合效果与性能测试，生成浅色与深色背景上的参考图像
+     * 用法：blendbench 字库 字宽 字高 位深 输出目录 [重复次数]
+     */
+    int BlendBench(int argc, char* argv[])
+    {
+        if (argc < 7)
+        {
+            cerr << "用法：H3FontTool blendbench 字库 字宽 字高 位深 输出目录 [重复次数]" << endl;
+            return 1;
+        }
+
+        SourceBank bank;
+        if (!LoadSourceBank(argv[2], atoi(argv[3]), atoi(argv[4]), atoi(argv[5]), bank))
+        {
+            return 1;
+        }
+        string outputDir = argv[6];
+        int nRepeat = argc > 7 ? max(atoi(argv[7]), 1) : 200;
+
+        // 取前64个非空字符，展开为8位覆盖度
+        const int nColumns = 16;
+        int nGlyphSize = bank.Width * bank.Height;
+        vector<uint8_t> coverage;
+        vector<uint8_t> glyph(nGlyphSize);
+        for (int nKey = 0; nKey < bank.GetKeyCount() && coverage.size() < 64 * (size_t)nGlyphSize; ++nKey)
+        {
+            const uint8_t* pPacked = bank.Find(nKey);
+            if (!pPacked)
+            {
+                continue;
+            }
+            ExpandGlyph(pPacked, glyph.data(), bank.Width, bank.Height, bank.BitDepth);
+            if (any_of(glyph.begin(), glyph.end(), [](uint8_t c) { return c; }))
+            {
+                coverage.insert(coverage.end(), glyph.begin(), glyph.end());
+            }
+        }
+        int nGlyphs = (int)(coverage.size() / nGlyphSize);
+        if (nGlyphs == 0)
+        {
+            cerr << "字库中没有字符" << endl;
+            return 1;
+        }
+
+        int nCanvasWidth = nColumns * (bank.Width + 2);
+        int nCanvasHeight = (nGlyphs + nColumns - 1) / nColumns * (bank.Height + 2);
+        GammaTable gamma = MakeGammaTable(2.2);
+        // 按字符逐行调用 drawRow(画布行, 覆盖度行)，各项测试共用相同的寻址
+        auto drawRows = [&](auto& canvas, auto drawRow) {
+            for (int i = 0; i < nGlyphs; ++i)
+            {
+                int nX = i % nColumns * (bank.Width + 2) + 1;
+                int nY = i / nColumns * (bank.Height + 2) + 1;
+                for (int nRow = 0; nRow < bank.Height; ++nRow)
+                {
+                    drawRow(canvas.data() + (nY + nRow) * nCanvasWidth + nX,
+                            coverage.data() + i * nGlyphSize + nRow * bank.Width);
+                }
+            }
+        };
+        auto blendPixels = [&](auto* pRow, const uint8_t* pCoverage, uint32_t nColor, const GammaTable* pGamma) {
+            for (int nColumn = 0; nColumn < bank.Width; ++nColumn)
+            {
+                if (!pCoverage[nColumn])
+                {
+                    continue;
+                }
+                if constexpr (sizeof(*pRow) == sizeof(uint16_t))
+                {
+                    pRow[nColumn] = BlendPixel565(pRow[nColumn], nColor, pCoverage[nColumn], pGamma);
+                }
+                else
+                {
+                    pRow[nColumn] = BlendPixel888(pRow[nColumn], nColor, pCoverage[nColumn], pGamma);
+                }
+            }
+        };
+        auto render = [&](vector<uint32_t>& canvas, uint32_t nColor, const GammaTable* pGamma) {
+            drawRows(canvas, [&](uint32_t* pRow, const uint8_t* pCoverage) {
+                if (pGamma)
+                {
+                    blendPixels(pRow, pCoverage, nColor, pGamma);
+                }
+                else
+                {
+                    BlendRow888(pRow, pCoverage, bank.Width, nColor);
+                }
+            });
+        };
+
+        // 浅色羊皮纸背景与深色背景，各生成直接混合与伽马校正混合两张参考图像
+        struct Background
+        {
+            const char* Name;
+            uint32_t Background;
+            uint32_t Text;
+        };
+        const Background backgrounds[] = {{"light", 0xF0E0C0, 0x402010}, {"dark", 0x202020, 0xF0D060}};
+        for (const Background& background : backgrounds)
+        {
+            for (bool bGamma : {false, true})
+            {
+                vector<uint32_t> canvas(nCanvasWidth * nCanvasHeight, background.Background);
+                render(canvas, background.Text, bGamma ? &gamma : nullptr);
+                string fileName = outputDir + "/blend_" + background.Name + (bGamma ? "_gamma.bmp" : ".bmp");
+                if (!WriteBitmap(fileName, canvas, nCanvasWidth, nCanvasHeight))
+                {
+                    cerr << "无法写入 " << fileName << endl;
+                    return 1;
+                }
+            }
+        }
+
+        // 批量混合与逐像素混合结果一致，32位与16位像素分别比较
+        vector<uint32_t> canvas(nCanvasWidth * nCanvasHeight, 0xF0E0C0);
+        vector<uint32_t> reference = canvas;
+        render(canvas, 0x402010, nullptr);
+        drawRows(reference, [&](uint32_t* pRow, const uint8_t* pCoverage) {
+            blendPixels(pRow, pCoverage, 0x402010, nullptr);
+        });
+        vector<uint16_t> canvas565(nCanvasWidth * nCanvasHeight, PackRgb565(0xF0E0C0));
+        vector<uint16_t> reference565 = canvas565;
+        drawRows(canvas565, [&](uint16_t* pRow, const uint8_t* pCoverage) {
+            BlendRow565(pRow, pCoverage, bank.Width, 0x402010);
+        });
+        drawRows(reference565, [&](uint16_t* pRow, const uint8_t* pCoverage) {
+            blendPixels(pRow, pCoverage, 0x402010, nullptr);
+        });
+        if (canvas != reference || canvas565 != reference565)
+        {
+            cerr << "批量混合与逐像素混合结果不一致" << endl;
+            return 1;
+        }
+
+        // 覆盖写入、逐像素混合与批量混合的吞吐量
+        auto measure = [&](auto drawRow) {
+            auto start = chrono::steady_clock::now();
+            for (int i = 0; i < nRepeat; ++i)
+            {
+                drawRows(canvas, drawRow);
+            }
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            return (double)nGlyphs * nGlyphSize * nRepeat / seconds / 1e6;
+        };
+        double overwriteSpeed = measure([&](uint32_t* pRow, const uint8_t* pCoverage) {
+            for (int nColumn = 0; nColumn < bank.Width; ++nColumn)
+            {
+                if (pCoverage[nColumn])
+                {
+                    pRow[nColumn] = 0x402010;
+                }
+            }
+        });
+        double scalarSpeed = measure([&](uint32_t* pRow, const uint8_t* pCoverage) {
+            blendPixels(pRow, pCoverage, 0x402010, nullptr);
+        });
+        double simdSpeed = measure([&](uint32_t* pRow, const uint8_t* pCoverage) {
+            BlendRow888(pRow, pCoverage, bank.Width, 0x402010);
+        });
+
+        printf("字符 %d 个，%dx%d\n", nGlyphs, bank.Width, bank.Height);
+        printf("覆盖写入 %.1f 百万像素/秒，逐像素混合 %.1f，批量混合 %.1f\n", overwriteSpeed, scalarSpeed, simdSpeed);
+        return 0;
+    }
+
+    /**
+     * @brief 线程池扩展性测试，按插件的行带划分与裁剪并行混合整屏字符，与单线程结果比较并输出各线程数的加速比
+     */
+    int PoolBench(int argc, char* argv[])
+    {
+        if (argc < 6)
+        {
+            cerr << "用法：H3FontTool poolbench 字库 字宽 字高 位深 [重复次数]" << endl;
+            return 1;
+        }
+
+        SourceBank bank;
+        if (!LoadSourceBank(argv[2], atoi(argv[3]), atoi(argv[4]), atoi(argv[5]), bank))
+        {
+            return 1;
+        }
+        int nRepeat = argc > 6 ? max(atoi(argv[6]), 1) : 50;
+
+        // 取前4096个非空字符，按每行64个排列，约为制作名单、战役简介整屏文字的数倍
+        const int nColumns = 64;
+        int nGlyphSize = bank.Width * bank.Height;
+        vector<uint8_t> coverage;
+        vector<uint8_t> glyph(nGlyphSize);
+        for (int nKey = 0; nKey < bank.GetKeyCount() && coverage.size() < 4096 * (size_t)nGlyphSize; ++nKey)
+        {
+            const uint8_t* pPacked = bank.Find(nKey);
+            if (!pPacked)
+            {
+                continue;
+            }
+            ExpandGlyph(pPacked, glyph.data(), bank.Width, bank.Height, bank.BitDepth);
+            if (any_of(glyph.begin(), glyph.end(), [](uint8_t c) { return c; }))
+            {
+                coverage.insert(coverage.end(), glyph.begin(), glyph.end());
+            }
+        }
+        int nGlyphs = (int)(coverage.size() / nGlyphSize);
+        if (nGlyphs == 0)
+        {
+            cerr << "字库中没有字符" << endl;
+            return 1;
+        }
+
+        // 字符按行错开0至2像素，与相邻字符重叠且跨越行带边界，检验行带裁剪与绘制顺序
+        int nCanvasWidth = nColumns * (bank.Width + 2);
+        int nGlyphRows = (nGlyphs + nColumns - 1) / nColumns;
+        int nCanvasHeight = nGlyphRows * (bank.Height + 2) + 2;
+        auto glyphLeft = [&](int i) { return i % nColumns * (bank.Width + 2) + 1; };
+        auto glyphTop = [&](int i) { return i / nColumns * (bank.Height + 2) + i % 3; };
+
+        // 与插件相同，每个行带绘制与其相交的字符并裁剪到行带内
+        atomic<int> nStraddling = 0;
+        auto drawBand = [&](vector<uint32_t>& canvas, int nBandTop, int nBandBottom) {
+            for (int i = 0; i < nGlyphs; ++i)
+            {
+                int nX = glyphLeft(i);
+                int nY = glyphTop(i);
+                if (!IntersectsGlyphBand(nY, bank.Height, nBandTop, nBandBottom))
+                {
+                    continue;
+                }
+                GlyphClip clip =
+                    ClipGlyph(nX, nY - nBandTop, bank.Width, bank.Height, nCanvasWidth, nBandBottom - nBandTop);
+                if (clip.nLastRow - clip.nFirstRow < bank.Height)
+                {
+                    ++nStraddling;
+                }
+                for (int nRow = clip.nFirstRow; nRow < clip.nLastRow; ++nRow)
+                {
+                    BlendRow888(canvas.data() + (nY + nRow) * nCanvasWidth + nX + clip.nFirstColumn,
+                                coverage.data() + i * nGlyphSize + nRow * bank.Width + clip.nFirstColumn,
+                                clip.nLastColumn - clip.nFirstColumn, 0x402010);
+                }
+            }
+        };
+
+        vector<uint32_t> reference(nCanvasWidth * nCanvasHeight, 0xF0E0C0);
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < nRepeat; ++i)
+        {
+            fill(reference.begin(), reference.end(), 0xF0E0C0);
+            drawBand(reference, 0, nCanvasHeight);
+        }
+        double serialTime = chrono::duration<double>(chrono::steady_clock::now() - start).count() / nRepeat;
+        printf("字符 %d 个，%dx%d，单线程 %.3f 毫秒/帧\n", nGlyphs, bank.Width, bank.Height, serialTime * 1e3);
+
+        size_t nMaxThreads = max(thread::hardware_concurrency(), 2u) - 1;
+        for (size_t nThreads = 1; nThreads <= nMaxThreads; nThreads *= 2)
+        {
+            WorkerPool pool(nThreads);
+            vector<uint32_t> canvas(reference.size());
+            nStraddling = 0;
+            start = chrono::steady_clock::now();
+            for (int i = 0; i < nRepeat; ++i)
+            {
+                fill(canvas.begin(), canvas.end(), 0xF0E0C0);
+                DrawGlyphBands(pool, 0, nCanvasHeight,
+                               [&](int nBandTop, int nBandBottom) { drawBand(canvas, nBandTop, nBandBottom); });
+            }
+            double time = chrono::duration<double>(chrono::steady_clock::now() - start).count() / nRepeat;
+            if (canvas != reference)
+            {
+                cerr << "多线程绘制与单线程结果不一致" << endl;
+                return 1;
+            }
+            printf("工作线程 %zu 个（另有调用线程），跨越行带的字符 %d 个，%.3f 毫秒/帧，加速比 %.2f\n", nThreads,
+                   nStraddling / nRepeat, time * 1e3, serialTime / time);
+        }
+        return 0;
+    }
+
+    /**
+     * @brief 一维平方距离变换（Felzenszwalb），f 为各点初始代价，结果写回 f
+     */
+    void DistanceTransform1D(float* f, int n, int nStride)
+    {
+        vector<float> values(n);
+        vector<int> parabolas(n);
+        vector<float> bounds(n + 1);
+        for (int i = 0; i < n; ++i)
+        {
+            values[i] = f[i * nStride];
+        }
+
+        int k = 0;
+        parabolas[0] = 0;
+        bounds[0] = -1e20f;
+        bounds[1] = 1e20f;
+        for (int q = 1; q < n; ++q)
+        {
+            float s;
+            for (;;)
+            {
+                int p = parabolas[k];
+                s = ((values[q] + q * q) - (values[p] + p * p)) / (2.0f * (q - p));
+                if (s > bounds[k] || k == 0)
+                {
+                    break;
+                }
+                --k;
+            }
+            if (s <= bounds[k])
+            {
+                // k == 0 且新抛物线完全覆盖旧抛物线
+                parabolas[0] = q;
+                bounds[1] = 1e20f;
+                continue;
+            }
+            ++k;
+            parabolas[k] = q;
+            bounds[k] = s;
+            bounds[k + 1] = 1e20f;
+        }
+
+        k = 0;
+        for (int q = 0; q < n; ++q)
+        {
+            while (bounds[k + 1] < q)
+            {
+                ++k;
+            }
+            int p = parabolas[k];
+            f[q * nStride] = (q - p) * (q - p) + values[p];
+        }
+    }
+
+    /**
+     * @brief 二维平方距离变换，cost 中目标像素为0，其余为极大值
+     */
+    void DistanceTransform2D(vector<float>& cost, int nWidth, int nHeight)
+    {
+        for (int x = 0; x < nWidth; ++x)
+        {
+            DistanceTransform1D(cost.data() + x, nHeight, nWidth);
+        }
+        for (int y = 0; y < nHeight; ++y)
+        {
+            DistanceTransform1D(cost.data() + y * nWidth, nWidth, 1);
+        }
+    }
+
+    /**
+     * @brief 由覆盖度生成距离场，字符框四周填充 nPadding 像素
+     * @param pCoverage 源覆盖度
+     * @param pField 输出距离场，大小为 nFieldWidth * nFieldHeight
+     */
+    void BuildDistanceField(const uint8_t* pCoverage, int nWidth, int nHeight, uint8_t* pField, int nFieldWidth,
+                            int nFieldHeight, int nPadding, int nSpread)
+    {
+        // 在源分辨率上计算有符号距离，源字符四周同样按比例填充
+        int nBoxWidth = nFieldWidth - nPadding * 2;
+        int nBoxHeight = nFieldHeight - nPadding * 2;
+        int nBoxSize = min(nBoxWidth, nBoxHeight);
+        int nMargin = (nPadding * max(nWidth, nHeight) + nBoxSize - 1) / nBoxSize + 1;
+        int nGridWidth = nWidth + nMargin * 2;
+        int nGridHeight = nHeight + nMargin * 2;
+        vector<float> toInside(nGridWidth * nGridHeight, 1e20f);
+        vector<float> toOutside(nGridWidth * nGridHeight, 0);
+        for (int y = 0; y < nHeight; ++y)
+        {
+            for (int x = 0; x < nWidth; ++x)
+            {
+                if (pCoverage[y * nWidth + x] >= 128)
+                {
+                    toInside[(y + nMargin) * nGridWidth + x + nMargin] = 0;
+                    toOutside[(y + nMargin) * nGridWidth + x + nMargin] = 1e20f;
+                }
+            }
+        }
+        DistanceTransform2D(toInside, nGridWidth, nGridHeight);
+        DistanceTransform2D(toOutside, nGridWidth, nGridHeight);
+
+        vector<float> distances(nGridWidth * nGridHeight);
+        for (int y = 0; y < nGridHeight; ++y)
+        {
+            for (int x = 0; x < nGridWidth; ++x)
+            {
+                int i = y * nGridWidth + x;
+                // 像素中心到边缘的距离，边缘在相邻两像素中间；抗锯齿边缘按覆盖度修正
+                float fDistance = toOutside[i] > 0 ? sqrt(toOutside[i]) - 0.5f : 0.5f - sqrt(toInside[i]);
+                int nX = x - nMargin;
+                int nY = y - nMargin;
+                if (nX >= 0 && nY >= 0 && nX < nWidth && nY < nHeight)
+                {
+                    uint8_t nCoverage = pCoverage[nY * nWidth + nX];
+                    if (nCoverage > 0 && nCoverage < 255 && fabs(fDistance) <= 0.5f)
+                    {
+                        fDistance = nCoverage / 255.0f - 0.5f;
+                    }
+                }
+                distances[i] = fDistance;
+            }
+        }
+
+        // 距离场像素中心按双线性插值读取源距离
+        float fScaleX = (float)nWidth / nBoxWidth;
+        float fScaleY = (float)nHeight / nBoxHeight;
+        for (int y = 0; y < nFieldHeight; ++y)
+        {
+            for (int x = 0; x < nFieldWidth; ++x)
+            {
+                float fx = min(max((x - nPadding + 0.5f) * fScaleX - 0.5f + nMargin, 0.0f), nGridWidth - 1.0f);
+                float fy = min(max((y - nPadding + 0.5f) * fScaleY - 0.5f + nMargin, 0.0f), nGridHeight - 1.0f);
+                int x0 = min((int)fx, nGridWidth - 2);
+                int y0 = min((int)fy, nGridHeight - 2);
+                float tx = fx - x0;
+                float ty = fy - y0;
+                const float* pRow = distances.data() + y0 * nGridWidth + x0;
+                float fDistance = (pRow[0] * (1 - tx) + pRow[1] * tx) * (1 - ty) +
+                                  (pRow[nGridWidth] * (1 - tx) + pRow[nGridWidth + 1] * tx) * ty;
+                // 源像素距离换算为距离场像素距离
+                fDistance /= (fScaleX + fScaleY) / 2;
+                pField[y * nFieldWidth + x] = (uint8_t)min(max(lround(128 + fDistance * 127 / nSpread), 0L), 255L);
+            }
+        }
+    }
+
+    /**
+     * @brief 将字库转换为距离场字库
+     * 用法：sdf 字库 字宽 字高 位深 距离场字宽 距离场字高 输出文件 [填充] [扩散]
+     */
+    int DistanceField(int argc, char* argv[])
+    {
+        if (argc < 9)
+        {
+            cerr << "用法：H3FontTool sdf 字库 字宽 字高 位深 距离场字宽 距离场字高 输出文件 [填充] [扩散]" << endl;
+            return 1;
+        }
+
+        SourceBank bank;
+        if (!LoadSourceBank(argv[2], atoi(argv[3]), atoi(argv[4]), atoi(argv[5]), bank))
+        {
+            return 1;
+        }
+        int nPadding = argc > 9 ? atoi(argv[9]) : 3;
+        int nSpread = argc > 10 ? atoi(argv[10]) : 4;
+        int nFieldWidth = atoi(argv[6]) + nPadding * 2;
+        int nFieldHeight = atoi(argv[7]) + nPadding * 2;
+        if (nFieldWidth <= nPadding * 2 || nFieldHeight <= nPadding * 2 || nPadding < 0 || nPadding > 255 ||
+            nSpread <= 0 || nSpread > 255 || (bank.Bank.Header && bank.Bank.IsDistanceField()))
+        {
+            cerr << "参数无效" << endl;
+            return 1;
+        }
+
+        // 普通HZK字库中全空白的字符视为不存在，不生成距离场
+        vector<int> order;
+        vector<uint8_t> coverage(bank.Width * bank.Height);
+        vector<uint8_t> fields;
+        for (int nKey = 0; nKey < bank.GetKeyCount(); ++nKey)
+        {
+            const uint8_t* pGlyph = bank.Find(nKey);
+            if (!pGlyph)
+            {
+                continue;
+            }
+            ExpandGlyph(pGlyph, coverage.data(), bank.Width, bank.Height, bank.BitDepth);
+            if (!bank.Bank.Header && ranges::none_of(coverage, [](uint8_t c) { return c; }))
+            {
+                continue;
+            }
+
+            order.push_back(nKey);
+            fields.resize(order.size() * nFieldWidth * nFieldHeight);
+            BuildDistanceField(coverage.data(), bank.Width, bank.Height,
+                               fields.data() + (order.size() - 1) * nFieldWidth * nFieldHeight, nFieldWidth,
+                               nFieldHeight, nPadding, nSpread);
+        }
+
+        uint16_t nFlags = GlyphBankDistanceField | (bank.IsUnicode() ? GlyphBankUnicodeKeys : 0);
+        vector<uint8_t> file = BuildGlyphBank(nFieldWidth, nFieldHeight, 8, nFlags, order,
+                                              [&, nSlot = (size_t)0](int) mutable {
+                                                  return fields.data() + nSlot++ * nFieldWidth * nFieldHeight;
+                                              });
+        GlyphBankHeader* pHeader = (GlyphBankHeader*)file.data();
+        pHeader->FieldPadding = (uint8_t)nPadding;
+        pHeader->FieldSpread = (uint8_t)nSpread;
+        if (!WriteFile(argv[8], file))
+        {
+            cerr << "无法写入 " << argv[8] << endl;
+            return 1;
+        }
+
+        printf("字符 %zu 个，距离场 %dx%d（填充 %d），字库 %zu 字节\n", order.size(), nFieldWidth, nFieldHeight,
+               nPadding, file.size());
+        return 0;
+    }
+
+    /**
+     * @brief 距离场采样与位图缓存绘制的耗时对比
+     * 用法：sdfbench 距离场字库 字宽 字高 [重复次数] [预览图]
+     */
+    int DistanceFieldBench(int argc, char* argv[])
+    {
+        if (argc < 5)
+        {
+            cerr << "用法：H3FontTool sdfbench 距离场字库 字宽 字高 [重复次数] [预览图]" << endl;
+            return 1;
+        }
+
+        SourceBank bank;
+        if (!LoadSourceBank(argv[2], 0, 0, 8, bank))
+        {
+            return 1;
+        }
+        if (!bank.Bank.Header || !bank.Bank.IsDistanceField())
+        {
+            cerr << "不是距离场字库" << endl;
+            return 1;
+        }
+        int nWidth = atoi(argv[3]);
+        int nHeight = atoi(argv[4]);
+        int nRepeat = argc > 5 ? max(atoi(argv[5]), 1) : 100;
+        if (nWidth <= 0 || nHeight <= 0)
+        {
+            cerr << "字符尺寸无效" << endl;
+            return 1;
+        }
+
+        vector<const uint8_t*> fields;
+        for (int nKey = 0; nKey < bank.GetKeyCount() && fields.size() < 1024; ++nKey)
+        {
+            if (const uint8_t* pField = bank.Find(nKey))
+            {
+                fields.push_back(pField);
+            }
+        }
+        if (fields.empty())
+        {
+            cerr << "字库中没有字符" << endl;
+            return 1;
+        }
+
+        const GlyphBankHeader* pHeader = bank.Bank.Header;
+        DistanceFieldSampler sampler(pHeader->Width, pHeader->Height, pHeader->FieldPadding, pHeader->FieldSpread,
+                                     nWidth, nHeight);
+        DistanceFieldSampler::Ramp ramp = sampler.MakeRamp(0, 1);
+        DistanceFieldSampler::Ramp shadowRamp = sampler.MakeRamp(0.5f, 2);
+
+        // 位图缓存：预先采样，绘制时只混合
+        int nGlyphSize = nWidth * nHeight;
+        vector<uint8_t> cache(fields.size() * nGlyphSize);
+        for (size_t i = 0; i < fields.size(); ++i)
+        {
+            sampler.Sample(fields[i], ramp, cache.data() + i * nGlyphSize, nWidth, nHeight);
+        }
+
+        const int nColumns = 32;
+        int nCanvasWidth = nColumns * (nWidth + 2);
+        int nCanvasHeight = ((int)fields.size() + nColumns - 1) / nColumns * (nHeight + 2);
+        vector<uint32_t> canvas(nCanvasWidth * nCanvasHeight, 0xF0E0C0);
+        auto locate = [&](size_t i) {
+            return canvas.data() + i / nColumns * (nHeight + 2) * nCanvasWidth + i % nColumns * (nWidth + 2);
+        };
+        auto blit = [&](size_t i, const uint8_t* pCoverage) {
+            uint32_t* pCanvas = locate(i);
+            for (int nRow = 0; nRow < nHeight; ++nRow)
+            {
+                BlendRow888(pCanvas + nRow * nCanvasWidth, pCoverage + nRow * nWidth, nWidth, 0x402010);
+            }
+        };
+        auto measure = [&](auto draw) {
+            auto start = chrono::steady_clock::now();
+            for (int n = 0; n < nRepeat; ++n)
+            {
+                for (size_t i = 0; i < fields.size(); ++i)
+                {
+                    draw(i);
+                }
+            }
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            return fields.size() * nRepeat / max(seconds, 1e-9);
+        };
+
+        vector<uint8_t> coverage(nGlyphSize);
+        double cachedSpeed = measure([&](size_t i) { blit(i, cache.data() + i * nGlyphSize); });
+        double sampledSpeed = measure([&](size_t i) {
+            sampler.Sample(fields[i], ramp, coverage.data(), nWidth, nHeight);
+            blit(i, coverage.data());
+        });
+        double shadowSpeed = measure([&](size_t i) {
+            sampler.Sample(fields[i], shadowRamp, coverage.data(), nWidth, nHeight, -1, -1);
+            blit(i, coverage.data());
+            sampler.Sample(fields[i], ramp, coverage.data(), nWidth, nHeight);
+            blit(i, coverage.data());
+        });
+
+        printf("字符 %zu 个，距离场 %dx%d -> %dx%d\n", fields.size(), pHeader->Width, pHeader->Height, nWidth, nHeight);
+        printf("位图缓存绘制 %.0f 字符/秒，距离场采样绘制 %.0f 字符/秒（%.1f 倍耗时），含柔和阴影 %.0f 字符/秒\n",
+               cachedSpeed, sampledSpeed, cachedSpeed / sampledSpeed, shadowSpeed);
+
+        if (argc > 6)
+        {
+            // 预览图：每个字符先绘制柔和阴影再绘制文字
+            fill(canvas.begin(), canvas.end(), 0xF0E0C0);
+            for (size_t i = 0; i < fields.size(); ++i)
+            {
+                uint32_t* pCanvas = locate(i);
+                sampler.Sample(fields[i], shadowRamp, coverage.data(), nWidth, nHeight, -1, -1);
+                for (int nRow = 0; nRow < nHeight; ++nRow)
+                {
+                    BlendRow888(pCanvas + nRow * nCanvasWidth, coverage.data() + nRow * nWidth, nWidth, 0);
+                }
+                blit(i, cache.data() + i * nGlyphSize);
+            }
+            if (!WriteBitmap(argv[6], canvas, nCanvasWidth, nCanvasHeight))
+            {
+                cerr << "无法写入 " << argv[6] << endl;
+                return 1;
+            }
+        }
+        return 0;
+    }
+    /**
+     * @brief 按插件的单词换行规则拆分单行文本：空格悬挂于行尾，单词内与左括号后不换行，连字符后可换行，
+     * 超宽时回退到上一个允许换行的位置，回退后仍超宽时在超宽处拆分
+     * @param text 文本
+     * @param charWidths 字宽
+     * @param nWidth 行宽
+     * @param nSameSplitWidth 输出拆分结果不变的最小行宽
+     * @return 行数
+     */
+    int SplitWords(string_view text, const array<int, 256>& charWidths, int nWidth, int& nSameSplitWidth)
+    {
+        enum : uint8_t
+        {
+            Space = 1,
+            Word = 2,
+            NoStart = 4,
+            NoEnd = 8
+        };
+        auto getClass = [](uint8_t c) -> uint8_t {
+            return c == ' ' ? Space : c == '-' ? NoStart : c == '(' ? NoEnd : isalnum(c) ? Word : 0;
+        };
+
+        int lineCount = 0;
+        int nLineBegin = 0;
+        int currentLineWidth = 0;
+        int breakIndex = 0;
+        int breakAdvance = 0;
+        uint8_t prevClass = 0;
+        nSameSplitWidth = 0;
+        for (int i = 0; i < (int)text.length(); ++i)
+        {
+            int charWidth = charWidths[(uint8_t)text[i]];
+            uint8_t breakClass = getClass(text[i]);
+            bool bBreakable = !(prevClass & NoEnd) && !(breakClass & NoStart) && !(prevClass & breakClass & Word);
+            if (bBreakable)
+            {
+                breakIndex = i;
+                breakAdvance = currentLineWidth;
+            }
+
+            if (currentLineWidth + charWidth <= nWidth)
+            {
+                nSameSplitWidth = max(nSameSplitWidth, currentLineWidth + charWidth);
+            }
+            if (currentLineWidth + charWidth > nWidth && i > nLineBegin && !(breakClass & Space))
+            {
+                ++lineCount;
+                if (!bBreakable && breakIndex > nLineBegin && currentLineWidth + charWidth - breakAdvance <= nWidth)
+                {
+                    nSameSplitWidth = max(nSameSplitWidth, currentLineWidth + charWidth - breakAdvance);
+                    nLineBegin = breakIndex;
+                    currentLineWidth += charWidth - breakAdvance;
+                }
+                else
+                {
+                    nLineBegin = i;
+                    currentLineWidth = charWidth;
+                }
+            }
+            else
+            {
+                currentLineWidth += charWidth;
+            }
+            prevClass = breakClass;
+        }
+        return lineCount + (nLineBegin < (int)text.length());
+    }
+
+    /**
+     * @brief 均衡行宽检查：逐段枚举拆分得到的最小行宽与逐一尝试每个行宽的结果比较，并统计二分查找偏宽的次数
+     */
+    int BalanceCheck(int argc, char* argv[])
+    {
+        // # 代表汉字：字宽较大，前后均允许换行
+        const string_view texts[] = {
+            "You have found a chest full of gold. Do you want to keep it or give it to the peasants for experience?",
+            "The well-fortified castle (built by the necromancer-king) overlooks a long-forgotten battlefield.",
+            " longerword #(",
+            "-longerword #longerword   ",
+            "##word## (longerword)##12345 ##-a ##",
+        };
+        array<int, 256> charWidths;
+        for (int i = 0; i < 256; ++i)
+        {
+            charWidths[i] = 3 + i % 5;
+        }
+        charWidths['#'] = 12;
+
+        int nCases = 0;
+        int nBinaryMisses = 0;
+        for (string_view text : texts)
+        {
+            auto split = [&](int nWidth, int& nSameSplitWidth) {
+                return SplitWords(text, charWidths, nWidth, nSameSplitWidth);
+            };
+            for (int nMaxWidth = 20; nMaxWidth <= 300; nMaxWidth += 5)
+            {
+                int nSameSplitWidth = 0;
+                int lineCount = split(nMaxWidth, nSameSplitWidth);
+
+                int nBruteWidth = nMaxWidth;
+                for (int nWidth = nMaxWidth; nWidth >= 1; --nWidth)
+                {
+                    nBruteWidth = split(nWidth, nSameSplitWidth) <= lineCount ? nWidth : nBruteWidth;
+                }
+
+                int nBalancedWidth = GetMinimumSplitWidth(1, nMaxWidth, split);
+                if (nBalancedWidth != nBruteWidth)
+                {
+                    cerr << "最小行宽不一致：最大行宽 " << nMaxWidth << "，逐段枚举 " << nBalancedWidth << "，逐一尝试 "
+                         << nBruteWidth << "，文本 " << text << endl;
+                    return 1;
+                }
+
+                // 二分查找的上界始终满足条件，行数不单调时可能停在更宽处
+                int nLow = 0;
+                int nHigh = nMaxWidth;
+                while (nHigh - nLow > 1)
+                {
+                    int nMid = (nLow + nHigh) / 2;
+                    (split(nMid, nSameSplitWidth) <= lineCount ? nHigh : nLow) = nMid;
+                }
+                nBinaryMisses += nHigh != nBruteWidth;
+                ++nCases;
+            }
+        }
+
+        printf("文本 %zu 段，最大行宽 %d 种，逐段枚举与逐一尝试的最小行宽一致，二分查找偏宽 %d 种\n", size(texts),
+               nCases, nBinaryMisses);
+        return 0;
+    }
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    string command = argc > 1 ? argv[1] : "";
+    if (command == "reorder")
+    {
+        return Reorder(argc, argv);
+    }
+    if (command == "subset")
+    {
+        return Subset(argc, argv);
+    }
+    if (command == "unicode")
+    {
+        return Unicode(argc, argv);
+    }
+    if (command == "scale")
+    {
+        return Scale(argc, argv);
+    }
+    if (command == "sdf")
+    {
+        return DistanceField(argc, argv);
+    }
+    if (command == "sdfbench")
+    {
+        return DistanceFieldBench(argc, argv);
+    }
+    if (command == "utf8bench")
+    {
+        return Utf8Bench(argc, argv);
+    }
+    if (command == "blendbench")
+    {
+        return BlendBench(argc, argv);
+    }
+    if (command == "poolbench")
+    {
+        return PoolBench(argc, argv);
+    }
+    if (command == "balancecheck")
+    {
+        return BalanceCheck(argc, argv);
+    }
+
+    cerr << "用法：H3FontTool <命令> [参数]" << endl;
+    cerr << "  reorder 字库 字宽 字高 位深 频率统计 输出文件    按使用频率重排字库" << endl;
+    cerr << "  subset 字库 字宽 字高 位深 输出文件 文本文件或目录...    根据游戏文本生成子集字库" << endl;
+    cerr << "  unicode 字库 字宽 字高 位深 输出文件    转换为按Unicode码位索引的字库" << endl;
+    cerr << "  scale 母版字库 字宽 字高 位深 目标字宽 目标字高 输出文件    按面积平均缩放生成8位字库" << endl;
+    cerr << "  sdf 字库 字宽 字高 位深 距离场字宽 距离场字高 输出文件 [填充] [扩散]    生成距离场字库" << endl;
+    cerr << "  sdfbench 距离场字库 字宽 字高 [重复次数] [预览图]    距离场采样与位图缓存绘制对比" << endl;
+    cerr << "  utf8bench 文本文件 [重复次数]    UTF-8文本扫描吞吐量测试" << endl;
+    cerr << "  blendbench 字库 字宽 字高 位深 输出目录 [重复次数]    文字混合参考图像与性能测试" << endl;
+    cerr << "  poolbench 字库 字宽 字高 位深 [重复次数]    线程池多线程绘制扩展性测试" << endl;
+    cerr << "  balancecheck    均衡行宽与逐一尝试的最小行宽对照检查" << endl;
+    return 1;
+}